@@ -0,0 +1,47 @@
+#ifndef S2HTML_H
+#define S2HTML_H
+
+#include <stddef.h>
+
+/*
+ * libs2html: C source in memory to highlighted HTML in memory. No files, no FILE *, nothing written to stdout or
+ * stderr; every call only touches its arguments, so calls may run on any number of threads at once. The HTML is the
+ * document the command line tool writes, byte for byte, for the same options.
+ */
+
+#if defined(__GNUC__)
+#define S2HTML_API				__attribute__((visibility("default")))
+#else
+#define S2HTML_API
+#endif
+
+/* Options, or'ed together; the values are those of the command line tool's CONVERT_* flags */
+#define S2HTML_LINE_NUMBERS		0x01	/* -n: gutter with the line number at each line start */
+#define S2HTML_EMBED_CSS		0x02	/* --embed-css: inline the theme rules the document uses, no styles.css needed */
+#define S2HTML_COMPACT			0x04	/* --compact: short class names, one span per run of same class tokens */
+#define S2HTML_LINE_ANCHORS		0x08	/* gutter spans carry id="L<line>" (with S2HTML_LINE_NUMBERS) */
+
+/* Return values */
+#define S2HTML_OK				0
+#define S2HTML_ERROR_ARGUMENT	(-1)	/* NULL pointer or unknown option bit */
+#define S2HTML_ERROR_MEMORY		(-2)	/* an allocation failed */
+#define S2HTML_ERROR_TOO_SMALL	(-3)	/* the caller's buffer cannot hold the HTML; *html_length is the size needed */
+
+/********** function prototypes **********/
+
+/* Converts source_length bytes at source into a buffer the library allocates and grows as the HTML is written. On
+   S2HTML_OK *html holds *html_length bytes followed by a NUL, to be released with s2html_free */
+S2HTML_API int s2html_convert(const char *source, size_t source_length, int options, char **html, size_t *html_length);
+
+/* Converts into the capacity bytes at buffer; only S2HTML_EMBED_CSS allocates, for a working copy of the body. Sets
+   *html_length to the size of the HTML either way, so after S2HTML_ERROR_TOO_SMALL a buffer of that size is enough */
+S2HTML_API int s2html_convert_to_buffer(const char *source, size_t source_length, int options, char *buffer, size_t capacity, size_t *html_length);
+
+/* Releases HTML returned by s2html_convert */
+S2HTML_API void s2html_free(char *html);
+
+/* Describes a return value */
+S2HTML_API const char *s2html_status_string(int status);
+
+#endif
+/**** End of file ****/
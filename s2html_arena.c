@@ -0,0 +1,180 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "s2html_arena.h"
+
+/* Bytes from the start of a block to its first usable byte, a multiple of the alignment */
+#define ARENA_HEADER_SIZE	((sizeof(arena_block_t) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+/********** Helper function implementations **********/
+
+static char *block_data(arena_block_t *block)
+{
+	return (char *)block + ARENA_HEADER_SIZE;
+}
+
+/* Rounds size up to the alignment; returns 0 when that overflows */
+static size_t aligned_size(size_t size)
+{
+	if (size > SIZE_MAX - ARENA_HEADER_SIZE - ARENA_ALIGNMENT)
+		return 0;
+	return (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+/* Makes a block with at least size free bytes current: the next held block when it is large enough, else a new one
+   linked in after the current block; returns 0 when out of memory */
+static int next_block(arena_t *arena, size_t size)
+{
+	arena_block_t *block = arena->current ? arena->current->next : arena->blocks;
+	size_t block_size;
+
+	if (block == NULL || block->size < size)
+	{
+		block_size = size > arena->block_size ? size : arena->block_size;
+		if (NULL == (block = malloc(ARENA_HEADER_SIZE + block_size)))
+			return 0;
+		block->size = block_size;
+		if (arena->current)
+		{
+			block->next = arena->current->next;
+			arena->current->next = block;
+		}
+		else
+		{
+			block->next = arena->blocks;
+			arena->blocks = block;
+		}
+		arena->reserved += block_size;
+		if (arena->reserved > arena->peak_reserved)
+			arena->peak_reserved = arena->reserved;
+	}
+	if (arena->current) /* the rest of the full block is not used again before the reset */
+		arena->used += arena->current->size - arena->offset;
+	arena->current = block;
+	arena->offset = 0;
+	return 1;
+}
+
+/* Reallocates the current block to hold size bytes: only for an allocation that starts the block, which then keeps
+   its bytes without a copy inside the arena; returns 0 when out of memory (the block is unchanged) */
+static int resize_current_block(arena_t *arena, size_t size)
+{
+	arena_block_t *block, **link = &arena->blocks;
+
+	while (*link != arena->current)
+		link = &(*link)->next;
+	if (NULL == (block = realloc(arena->current, ARENA_HEADER_SIZE + size)))
+		return 0;
+	arena->reserved += size - block->size;
+	if (arena->reserved > arena->peak_reserved)
+		arena->peak_reserved = arena->reserved;
+	block->size = size;
+	*link = block;
+	arena->current = block;
+	arena->last = block_data(block);
+	return 1;
+}
+
+/* ********************************************************************************************************************** */
+/* ********************************************************************************************************************** */
+
+/* Prepares an empty arena whose blocks hold block_size bytes (0 => ARENA_DEFAULT_BLOCK_SIZE); nothing is allocated yet */
+void init_arena(arena_t *arena, size_t block_size)
+{
+	memset(arena, 0, sizeof(*arena));
+	arena->block_size = block_size ? aligned_size(block_size) : ARENA_DEFAULT_BLOCK_SIZE;
+	if (arena->block_size == 0)
+		arena->block_size = ARENA_DEFAULT_BLOCK_SIZE;
+}
+
+/* Returns size bytes aligned to ARENA_ALIGNMENT that live until the next reset, or NULL when out of memory */
+void *arena_alloc(arena_t *arena, size_t size)
+{
+	size_t rounded = aligned_size(size ? size : 1);
+
+	if (rounded == 0)
+		return NULL;
+	if ((arena->current == NULL || rounded > arena->current->size - arena->offset) && !next_block(arena, rounded))
+		return NULL;
+	arena->last = block_data(arena->current) + arena->offset;
+	arena->offset += rounded;
+	arena->used += rounded;
+	if (arena->used > arena->high_water)
+		arena->high_water = arena->used;
+	return arena->last;
+}
+
+/* Resizes an allocation to new_size bytes, keeping its first old_size: in place when it is the most recent one and
+   its block has room, by reallocating the block when it is alone in it (a buffer that keeps growing ends up in a
+   block of its own), else by copying it to a new allocation; returns NULL when out of memory (data stays valid) */
+void *arena_grow(arena_t *arena, void *data, size_t old_size, size_t new_size)
+{
+	size_t rounded = aligned_size(new_size), start;
+	void *grown;
+
+	if (data != NULL && data == arena->last && rounded != 0)
+	{
+		start = arena->last - block_data(arena->current);
+		if (rounded > arena->current->size - start && start == 0 && resize_current_block(arena, rounded))
+			data = arena->last;
+		if (rounded <= arena->current->size - start)
+		{
+			arena->used += rounded - (arena->offset - start);
+			arena->offset = start + rounded;
+			if (arena->used > arena->high_water)
+				arena->high_water = arena->used;
+			return data;
+		}
+	}
+	if (NULL == (grown = arena_alloc(arena, new_size)))
+		return NULL;
+	if (data != NULL)
+		memcpy(grown, data, old_size < new_size ? old_size : new_size);
+	return grown;
+}
+
+/* Empties the arena in constant time: every allocation is gone, every block stays for the next conversion */
+void arena_reset(arena_t *arena)
+{
+	arena->current = NULL;
+	arena->offset = 0;
+	arena->last = NULL;
+	arena->used = 0;
+	arena->resets++;
+}
+
+/* Right after a reset, releases held blocks until at most keep_size bytes remain, so one outsized conversion does not
+   pin its memory in a long running process */
+void trim_arena(arena_t *arena, size_t keep_size)
+{
+	arena_block_t **link = &arena->blocks, *block;
+	size_t kept = 0;
+
+	if (arena->current != NULL || arena->reserved <= keep_size)
+		return;
+	while (NULL != (block = *link))
+	{
+		if (kept + block->size <= keep_size)
+		{
+			kept += block->size;
+			link = &block->next;
+			continue;
+		}
+		*link = block->next;
+		arena->reserved -= block->size;
+		free(block);
+	}
+}
+
+/* Releases every block; the arena can be used again after init_arena */
+void free_arena(arena_t *arena)
+{
+	arena_block_t *block, *next;
+
+	for (block = arena->blocks; block != NULL; block = next)
+	{
+		next = block->next;
+		free(block);
+	}
+	memset(arena, 0, sizeof(*arena));
+}
@@ -0,0 +1,45 @@
+#ifndef S2HTML_ARENA_H
+#define S2HTML_ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_DEFAULT_BLOCK_SIZE	(1024u * 1024)	/* first block; size it from the high water mark of the workload */
+#define ARENA_ALIGNMENT				16				/* every allocation starts on this boundary */
+
+/* One malloc'ed block, its bytes follow the header */
+typedef struct s2html_arena_block
+{
+	struct s2html_arena_block *next;	// blocks are kept across resets, in the order they are used
+	size_t size;						// bytes after the header
+}arena_block_t;
+
+/*
+ * Scratch memory of one conversion after the other: allocations are cut from the current block and never freed one by
+ * one, the whole arena is emptied at once by arena_reset. Blocks stay allocated, so once the arena has grown to the
+ * size of the largest conversion the following ones allocate nothing.
+ */
+typedef struct s2html_arena
+{
+	arena_block_t *blocks;		// every block held, the first is used first
+	arena_block_t *current;		// block allocations are cut from, NULL before the first allocation
+	size_t offset;				// bytes of current handed out
+	size_t block_size;			// size of blocks added for allocations that fit in one
+	char *last;					// most recent allocation, the only one arena_grow extends in place
+	size_t used;				// bytes taken since the reset, padding and the unused ends of full blocks included
+	size_t high_water;			// largest used over every reset: a first block this large serves any of them alone
+	size_t reserved;			// bytes held in blocks
+	size_t peak_reserved;		// largest reserved
+	unsigned long long resets;	// times the arena was emptied
+}arena_t;
+
+/********** function prototypes **********/
+
+void init_arena(arena_t *arena, size_t block_size);
+void *arena_alloc(arena_t *arena, size_t size);
+void *arena_grow(arena_t *arena, void *data, size_t old_size, size_t new_size);
+void arena_reset(arena_t *arena);
+void trim_arena(arena_t *arena, size_t keep_size);
+void free_arena(arena_t *arena);
+
+#endif
+/**** End of file ****/
@@ -0,0 +1,307 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "s2html_event.h"
+#include "s2html_conv.h"
+#include "s2html_batch.h"
+
+#define FILE_LIST_INITIAL_CAPACITY	64
+
+/* Per worker deque of job indices: the owner pops from the tail, thieves take from the head */
+typedef struct
+{
+	pthread_mutex_t lock;
+	int head;
+	int tail;
+}job_queue_t;
+
+typedef struct
+{
+	const batch_config_t *config;
+	job_queue_t *queues;		// one per worker, shared
+	int worker_index;			// index of this worker's own queue
+	int started;				// thread was created and must be joined
+	pthread_t thread;
+	arena_t arena;				// scratch memory of the conversion in progress, reset before each file
+	batch_result_t result;
+}batch_worker_t;
+
+/********** Helper function implementations **********/
+
+/* Takes the most recently queued job of the worker's own queue; returns -1 if it is empty */
+static int pop_own_job(job_queue_t *queue)
+{
+	int job = -1;
+
+	pthread_mutex_lock(&queue->lock);
+	if (queue->head < queue->tail)
+		job = --queue->tail;
+	pthread_mutex_unlock(&queue->lock);
+	return job;
+}
+
+/* Takes the oldest job of another worker's queue; returns -1 if it is empty */
+static int steal_job(job_queue_t *queue)
+{
+	int job = -1;
+
+	pthread_mutex_lock(&queue->lock);
+	if (queue->head < queue->tail)
+		job = queue->head++;
+	pthread_mutex_unlock(&queue->lock);
+	return job;
+}
+
+/* Next job for worker: its own queue first, then the other queues in turn; -1 once all are empty */
+static int next_job(batch_worker_t *worker)
+{
+	int worker_count = worker->config->worker_count;
+	int job, victim;
+
+	if ((job = pop_own_job(&worker->queues[worker->worker_index])) >= 0)
+		return job;
+	for (victim = 1; victim < worker_count; victim++)
+	{
+		if ((job = steal_job(&worker->queues[(worker->worker_index + victim) % worker_count])) >= 0)
+			return job;
+	}
+	return -1; /* no job is ever added, so empty queues mean the batch is done */
+}
+
+/* Builds the output path of input_path: <input>.html, or mirrored below output_directory; returns 0 if it does not fit */
+static int build_output_path(char *output_path, const char *output_directory, const char *input_path)
+{
+	size_t length;
+	const char *segment_end;
+
+	if (output_directory == NULL)
+		return snprintf(output_path, BATCH_PATH_LENGTH, "%s.html", input_path) < BATCH_PATH_LENGTH;
+
+	length = snprintf(output_path, BATCH_PATH_LENGTH, "%s", output_directory);
+	while (*input_path && length < BATCH_PATH_LENGTH)
+	{
+		/* Copy one path segment; empty, "." and ".." segments must not leave the output directory */
+		while (*input_path == '/')
+			input_path++;
+		if ((segment_end = strchr(input_path, '/')) == NULL)
+			segment_end = input_path + strlen(input_path);
+		if (segment_end - input_path == 1 && input_path[0] == '.')
+		{
+			input_path = segment_end;
+			continue;
+		}
+		if (segment_end - input_path == 2 && input_path[0] == '.' && input_path[1] == '.')
+			length += snprintf(output_path + length, BATCH_PATH_LENGTH - length, "/__");
+		else if (segment_end > input_path)
+			length += snprintf(output_path + length, BATCH_PATH_LENGTH - length, "/%.*s", (int)(segment_end - input_path), input_path);
+		input_path = segment_end;
+	}
+	if (length < BATCH_PATH_LENGTH)
+		length += snprintf(output_path + length, BATCH_PATH_LENGTH - length, ".html");
+	return length < BATCH_PATH_LENGTH;
+}
+
+/* Creates every missing directory leading up to the file at path */
+static void make_parent_directories(char *path)
+{
+	char *separator;
+
+	for (separator = strchr(path + 1, '/'); separator != NULL; separator = strchr(separator + 1, '/'))
+	{
+		*separator = '\0';
+		mkdir(path, 0777); /* EEXIST is expected, other failures surface when the file is created */
+		*separator = '/';
+	}
+}
+
+/* Converts the worker's share of the batch, stealing from the others once its own queue is empty */
+static void *batch_worker_main(void *argument)
+{
+	batch_worker_t *worker = argument;
+	const batch_config_t *config = worker->config;
+	char output_path[BATCH_PATH_LENGTH];
+	const char *error;
+	int job;
+
+	while ((job = next_job(worker)) >= 0)
+	{
+		if (!build_output_path(output_path, config->output_directory, config->input_files[job]))
+		{
+			error = "output path too long";
+		}
+		else
+		{
+			if (config->output_directory)
+				make_parent_directories(output_path);
+			arena_reset(&worker->arena);
+			if (config->cache)
+				error = convert_file_cached(config->cache, config->input_files[job], output_path, config->options, &worker->arena);
+			else
+				error = convert_file_to_html(config->input_files[job], output_path, config->options, &worker->arena);
+		}
+
+		if (error)
+		{
+			fprintf(stderr, "Error! %s: %s\n", config->input_files[job], error);
+			worker->result.failed++;
+		}
+		else
+		{
+			worker->result.converted++;
+		}
+	}
+	return NULL;
+}
+
+/* ********************************************************************************************************************** */
+/* ********************************************************************************************************************** */
+
+/* Converts one file, with the output buffers cut from arena when it is not NULL; returns NULL on success or a
+   description of the failure */
+const char *convert_file_to_html(const char *input_path, const char *output_path, int options, arena_t *arena)
+{
+	source_buffer_t source;
+	output_buffer_t destination;
+	FILE *destination_stream;
+	const char *error = NULL;
+
+	if (!open_source_buffer(&source, input_path))
+		return "could not be opened";
+	if (NULL == (destination_stream = fopen(output_path, "w")))
+	{
+		close_source_buffer(&source);
+		return "could not create output file";
+	}
+	if (arena ? !open_arena_output_buffer(&destination, destination_stream, arena) : !open_output_buffer(&destination, destination_stream))
+	{
+		error = "could not allocate output buffer";
+	}
+	else
+	{
+		convert_source_to_html(&source, &destination, options);
+		if (!close_output_buffer(&destination))
+			error = "could not write output file";
+	}
+	if (fclose(destination_stream) != 0 && error == NULL)
+		error = "could not write output file";
+	close_source_buffer(&source);
+	return error;
+}
+
+/* Reads newline separated paths (e.g. from find) into a heap array; returns NULL when out of memory or the list could
+   not be read, never a partial list */
+char **read_file_list(FILE *list_stream, int *file_count)
+{
+	char **input_files = NULL, **grown;
+	char *line = NULL;
+	size_t line_capacity = 0;
+	ssize_t length;
+	int capacity = 0, failed = 0;
+
+	*file_count = 0;
+	while (!failed && (length = getline(&line, &line_capacity, list_stream)) >= 0)
+	{
+		while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+			line[--length] = '\0';
+		if (length == 0)
+			continue;
+		if (*file_count == capacity)
+		{
+			capacity = capacity ? capacity * 2 : FILE_LIST_INITIAL_CAPACITY;
+			if (NULL == (grown = realloc(input_files, capacity * sizeof(*input_files))))
+			{
+				failed = 1;
+				break;
+			}
+			input_files = grown;
+		}
+		if (NULL == (input_files[*file_count] = strdup(line)))
+			failed = 1;
+		else
+			(*file_count)++;
+	}
+	free(line);
+	if (failed || ferror(list_stream))
+	{
+		free_file_list(input_files, *file_count);
+		*file_count = 0;
+		return NULL;
+	}
+	if (input_files == NULL)
+		input_files = calloc(1, sizeof(*input_files));
+	return input_files;
+}
+
+void free_file_list(char **input_files, int file_count)
+{
+	int i;
+	for (i = 0; i < file_count; i++)
+		free(input_files[i]);
+	free(input_files);
+}
+
+/* Converts every input file on config->worker_count threads; failures are reported on stderr and counted */
+batch_result_t run_batch(const batch_config_t *config)
+{
+	batch_config_t effective = *config;
+	batch_result_t total = {0, 0, 0, 0};
+	batch_worker_t *workers;
+	job_queue_t *queues;
+	int i;
+
+	if (effective.file_count == 0)
+		return total;
+	if (effective.worker_count < 1)
+		effective.worker_count = 1;
+	if (effective.worker_count > BATCH_MAX_WORKERS)
+		effective.worker_count = BATCH_MAX_WORKERS;
+	if (effective.worker_count > effective.file_count)
+		effective.worker_count = effective.file_count;
+
+	workers = calloc(effective.worker_count, sizeof(*workers));
+	queues = calloc(effective.worker_count, sizeof(*queues));
+	if (workers == NULL || queues == NULL)
+	{
+		free(workers);
+		free(queues);
+		fprintf(stderr, "Error! could not allocate %d batch workers\n", effective.worker_count);
+		total.failed = effective.file_count;
+		return total;
+	}
+
+	/* Deal contiguous ranges of files to the workers */
+	for (i = 0; i < effective.worker_count; i++)
+	{
+		pthread_mutex_init(&queues[i].lock, NULL);
+		queues[i].head = (int)((long long)effective.file_count * i / effective.worker_count);
+		queues[i].tail = (int)((long long)effective.file_count * (i + 1) / effective.worker_count);
+		workers[i].config = &effective;
+		workers[i].queues = queues;
+		workers[i].worker_index = i;
+		init_arena(&workers[i].arena, effective.arena_size);
+	}
+
+	/* Worker 0 runs on the calling thread; a worker whose thread cannot start has its queue stolen */
+	for (i = 1; i < effective.worker_count; i++)
+		workers[i].started = pthread_create(&workers[i].thread, NULL, batch_worker_main, &workers[i]) == 0;
+	batch_worker_main(&workers[0]);
+
+	for (i = 0; i < effective.worker_count; i++)
+	{
+		if (workers[i].started)
+			pthread_join(workers[i].thread, NULL);
+		total.converted += workers[i].result.converted;
+		total.failed += workers[i].result.failed;
+		if (workers[i].arena.high_water > total.arena_high_water)
+			total.arena_high_water = workers[i].arena.high_water;
+		if (workers[i].arena.peak_reserved > total.arena_reserved)
+			total.arena_reserved = workers[i].arena.peak_reserved;
+		free_arena(&workers[i].arena);
+		pthread_mutex_destroy(&queues[i].lock);
+	}
+	free(workers);
+	free(queues);
+	return total;
+}
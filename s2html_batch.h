@@ -0,0 +1,37 @@
+#ifndef S2HTML_BATCH_H
+#define S2HTML_BATCH_H
+
+#include "s2html_cache.h"
+#include "s2html_arena.h"
+
+#define BATCH_MAX_WORKERS		256
+#define BATCH_PATH_LENGTH		4096
+
+typedef struct
+{
+	char **input_files;			// source paths to convert
+	int file_count;				// number of entries in input_files
+	int worker_count;			// threads converting in parallel
+	const char *output_directory;	// NULL => write <input>.html next to each input
+	int options;				// CONVERT_* flags: -n, --embed-css
+	conversion_cache_t *cache;	// NULL => convert every file
+	size_t arena_size;			// block size of each worker's scratch arena, 0 => ARENA_DEFAULT_BLOCK_SIZE
+}batch_config_t;
+
+typedef struct
+{
+	int converted;				// files written successfully
+	int failed;					// files reported as failures
+	size_t arena_high_water;	// most scratch memory a single conversion took
+	size_t arena_reserved;		// most scratch memory a worker held at once
+}batch_result_t;
+
+/********** function prototypes **********/
+
+char **read_file_list(FILE *list_stream, int *file_count);
+void free_file_list(char **input_files, int file_count);
+batch_result_t run_batch(const batch_config_t *config);
+const char *convert_file_to_html(const char *input_path, const char *output_path, int options, arena_t *arena);
+
+#endif
+/**** End of file ****/
@@ -0,0 +1,654 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "s2html_event.h"
+#include "s2html_escape.h"
+#include "s2html_conv.h"
+
+#define DEFAULT_CORPUS_MEGABYTES	16
+#define DEFAULT_CORPUS_SEED			1
+#define BENCH_REPEAT				3
+#define BENCH_JSON_VERSION			1	/* bump when the JSON layout changes */
+
+/* Fragment kinds the generator mixes; a corpus mix is a weight per kind */
+enum
+{
+	FRAGMENT_COMMENT,
+	FRAGMENT_STRING,
+	FRAGMENT_PREPROCESSOR,
+	FRAGMENT_IDENTIFIER,
+	FRAGMENT_KIND_COUNT
+};
+
+typedef struct
+{
+	const char *name;
+	int weights[FRAGMENT_KIND_COUNT];	// relative share of each fragment kind
+}corpus_mix_t;
+
+static const corpus_mix_t corpus_mixes[] = {
+	{"comment",			{70, 10, 10, 10}},
+	{"string",			{10, 70, 10, 10}},
+	{"preprocessor",	{10, 10, 70, 10}},
+	{"identifier",		{10, 10, 10, 70}},
+	{"mixed",			{25, 25, 25, 25}},
+};
+
+static const char *const identifier_words[] = {
+	"count", "index", "buffer", "length", "node", "next", "value", "result", "state", "context", "table", "entry",
+	"offset", "limit", "flags", "total", "source", "output", "handle", "cursor",
+};
+
+static const char *const type_words[] = {
+	"int", "char", "unsigned", "long", "size_t", "double", "static int", "const char *", "struct node *", "_Bool",
+};
+
+static const char *const comment_words[] = {
+	"the", "lexer", "keeps", "state", "between", "calls", "so", "a", "token", "may", "span", "lines", "and", "<tags>",
+	"&", "escapes", "must", "survive", "TODO:", "fix", "this", "later",
+};
+
+/* One benchmark result: pass over a corpus */
+typedef struct
+{
+	const char *name;
+	double seconds;				// best of BENCH_REPEAT
+}pass_timing_t;
+
+typedef struct
+{
+	int json;					// non-zero => machine readable report on stdout
+	int first_record;			// JSON: no comma before the next record
+}bench_report_t;
+
+/********** Helper function implementations **********/
+
+static double now_seconds(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* xorshift64*: deterministic so a seed always reproduces the same corpus */
+static unsigned long long next_random(unsigned long long *state)
+{
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return *state * 0x2545f4914f6cdd1dULL;
+}
+
+static unsigned pick(unsigned long long *state, unsigned count)
+{
+	return (unsigned)(next_random(state) >> 33) % count;
+}
+
+#define PICK_WORD(state, words)	((words)[pick(state, sizeof(words) / sizeof((words)[0]))])
+
+static void append_text(output_buffer_t *corpus, const char *text)
+{
+	output_append(corpus, text, strlen(text));
+}
+
+static void append_words(output_buffer_t *corpus, unsigned long long *state, int count)
+{
+	while (count-- > 0)
+	{
+		append_text(corpus, PICK_WORD(state, comment_words));
+		output_append_char(corpus, ' ');
+	}
+}
+
+static void generate_comment(output_buffer_t *corpus, unsigned long long *state)
+{
+	int lines;
+
+	if (pick(state, 2))
+	{
+		append_text(corpus, "// ");
+		append_words(corpus, state, 4 + pick(state, 8));
+		output_append_char(corpus, '\n');
+		return;
+	}
+	append_text(corpus, "/* ");
+	for (lines = 1 + pick(state, 5); lines > 0; lines--)
+	{
+		append_words(corpus, state, 6 + pick(state, 8));
+		if (lines > 1)
+			append_text(corpus, "\n * ");
+	}
+	append_text(corpus, "*/\n");
+}
+
+static void generate_string(output_buffer_t *corpus, unsigned long long *state)
+{
+	static const char *const pieces[] = {
+		"value ", "%d ", "%s", "%-8.3f", "\\n", "\\t", "\\\"quoted\\\" ", "<b>", "&amp; ", "%zu items ", "path\\\\to ",
+	};
+	static const char *const characters[] = { "'a'", "'\\n'", "'\\''", "'<'", "'0'" };
+	int count;
+
+	append_text(corpus, "\tprintf(\"");
+	for (count = 2 + pick(state, 6); count > 0; count--)
+		append_text(corpus, PICK_WORD(state, pieces));
+	append_text(corpus, "\", ");
+	append_text(corpus, PICK_WORD(state, identifier_words));
+	append_text(corpus, ", ");
+	append_text(corpus, PICK_WORD(state, characters));
+	append_text(corpus, ");\n");
+}
+
+static void generate_preprocessor(output_buffer_t *corpus, unsigned long long *state)
+{
+	static const char *const system_headers[] = { "stdio.h", "stdlib.h", "string.h", "sys/types.h", "pthread.h" };
+	char number[32];
+
+	switch (pick(state, 5))
+	{
+	case 0:
+		append_text(corpus, "#include <");
+		append_text(corpus, PICK_WORD(state, system_headers));
+		append_text(corpus, ">\n");
+		break;
+	case 1:
+		append_text(corpus, "#include \"");
+		append_text(corpus, PICK_WORD(state, identifier_words));
+		append_text(corpus, ".h\"\n");
+		break;
+	case 2:
+		snprintf(number, sizeof(number), "%u", pick(state, 4096));
+		append_text(corpus, "#define ");
+		append_text(corpus, PICK_WORD(state, identifier_words));
+		append_text(corpus, "_LIMIT (");
+		append_text(corpus, number);
+		append_text(corpus, " * 2)\n");
+		break;
+	case 3:
+		append_text(corpus, "#ifdef ");
+		append_text(corpus, PICK_WORD(state, identifier_words));
+		append_text(corpus, "_ENABLED\n#undef ");
+		append_text(corpus, PICK_WORD(state, identifier_words));
+		append_text(corpus, "\n#endif\n");
+		break;
+	default:
+		append_text(corpus, "#if defined(DEBUG) && LEVEL > 2\n#pragma once\n#endif\n");
+		break;
+	}
+}
+
+static void generate_identifiers(output_buffer_t *corpus, unsigned long long *state)
+{
+	char number[32];
+
+	snprintf(number, sizeof(number), pick(state, 2) ? "%u" : "0x%x", pick(state, 100000));
+	switch (pick(state, 3))
+	{
+	case 0:
+		append_text(corpus, PICK_WORD(state, type_words));
+		output_append_char(corpus, ' ');
+		append_text(corpus, PICK_WORD(state, identifier_words));
+		append_text(corpus, "_value = ");
+		append_text(corpus, PICK_WORD(state, identifier_words));
+		append_text(corpus, " + ");
+		append_text(corpus, number);
+		append_text(corpus, ";\n");
+		break;
+	case 1:
+		append_text(corpus, "\tfor (index = 0; index < ");
+		append_text(corpus, PICK_WORD(state, identifier_words));
+		append_text(corpus, "; index++)\n\t\ttotal += ");
+		append_text(corpus, PICK_WORD(state, identifier_words));
+		append_text(corpus, "[index] * scale;\n");
+		break;
+	default:
+		append_text(corpus, "\tif (");
+		append_text(corpus, PICK_WORD(state, identifier_words));
+		append_text(corpus, " != NULL && flags & 4)\n\t\treturn ");
+		append_text(corpus, PICK_WORD(state, identifier_words));
+		append_text(corpus, "->next;\n\telse\n\t\tcontinue;\n");
+		break;
+	}
+}
+
+/* Fills corpus with about target_size bytes of C source in the proportions of mix */
+static int generate_corpus(output_buffer_t *corpus, const corpus_mix_t *mix, size_t target_size, unsigned long long seed)
+{
+	unsigned long long state = seed ? seed : DEFAULT_CORPUS_SEED;
+	int total_weight = 0, roll, kind;
+
+	for (kind = 0; kind < FRAGMENT_KIND_COUNT; kind++)
+		total_weight += mix->weights[kind];
+	if (!open_memory_output_buffer(corpus))
+		return 0;
+
+	while (corpus->length < target_size && !corpus->error)
+	{
+		roll = pick(&state, total_weight);
+		for (kind = 0; roll >= mix->weights[kind]; kind++)
+			roll -= mix->weights[kind];
+		switch (kind)
+		{
+		case FRAGMENT_COMMENT:
+			generate_comment(corpus, &state);
+			break;
+		case FRAGMENT_STRING:
+			generate_string(corpus, &state);
+			break;
+		case FRAGMENT_PREPROCESSOR:
+			generate_preprocessor(corpus, &state);
+			break;
+		default:
+			generate_identifiers(corpus, &state);
+			break;
+		}
+	}
+	return !corpus->error;
+}
+
+/* Repeats sample until the corpus holds target_size bytes */
+static int build_sample_corpus(output_buffer_t *corpus, const char *sample, size_t sample_size, size_t target_size)
+{
+	size_t count;
+
+	if (sample_size == 0 || !open_memory_output_buffer(corpus))
+		return 0;
+	while (corpus->length < target_size && !corpus->error)
+	{
+		count = target_size - corpus->length < sample_size ? target_size - corpus->length : sample_size;
+		output_append(corpus, sample, count);
+	}
+	return !corpus->error;
+}
+
+/* Appends the entity for a special byte, or the byte itself */
+static size_t write_escaped_char(char *out, char character)
+{
+	switch (character)
+	{
+	case '<':
+		memcpy(out, "&lt;", 4);
+		return 4;
+	case '>':
+		memcpy(out, "&gt;", 4);
+		return 4;
+	case '&':
+		memcpy(out, "&amp;", 5);
+		return 5;
+	default:
+		*out = character;
+		return 1;
+	}
+}
+
+/* Reference path: tests every byte, like the original per-character loop */
+static size_t escape_bytewise(const char *text, size_t length, char *out)
+{
+	size_t i, written = 0;
+	for (i = 0; i < length; i++)
+		written += write_escaped_char(out + written, text[i]);
+	return written;
+}
+
+/* Fast path: scan to the next special byte and copy the clean run in bulk */
+static size_t escape_with_kernel(escape_scan_fn scan, const char *text, size_t length, char *out)
+{
+	size_t i = 0, run_length, written = 0;
+	while (i < length)
+	{
+		run_length = scan(text + i, length - i);
+		memcpy(out + written, text + i, run_length);
+		written += run_length;
+		i += run_length;
+		if (i < length)
+			written += write_escaped_char(out + written, text[i++]);
+	}
+	return written;
+}
+
+/* Prints one result as a text row or a JSON object; tokens is 0 for passes that do not work on tokens */
+static void report_pass(bench_report_t *report, const char *corpus_name, size_t corpus_size, size_t tokens, const pass_timing_t *pass)
+{
+	double megabytes = corpus_size / (1024.0 * 1024.0);
+
+	if (!report->json)
+	{
+		printf("%-14s %-10s %10.4f %10.1f", corpus_name, pass->name, pass->seconds, megabytes / pass->seconds);
+		if (tokens)
+			printf(" %12.0f", tokens / pass->seconds);
+		printf("\n");
+		return;
+	}
+	printf("%s\n    {\"corpus\": \"%s\", \"pass\": \"%s\", \"bytes\": %zu, \"tokens\": %zu, \"seconds\": %.6f, \"mb_per_s\": %.2f, \"tokens_per_s\": %.0f}",
+		   report->first_record ? "" : ",", corpus_name, pass->name, corpus_size, tokens, pass->seconds, megabytes / pass->seconds,
+		   tokens ? tokens / pass->seconds : 0.0);
+	report->first_record = 0;
+}
+
+/* Times every escape kernel over corpus against the bytewise reference; returns 0 on mismatch or allocation failure */
+static int bench_escape_kernels(bench_report_t *report, const char *corpus_name, const char *corpus, size_t corpus_size)
+{
+	struct
+	{
+		const char *name;
+		escape_scan_fn scan;		/* NULL => byte-at-a-time reference */
+	} kernels[] = {
+		{"bytewise", NULL},
+		{"scalar", escape_scan_scalar},
+#ifdef ESCAPE_HAVE_X86_KERNELS
+		{"sse2", escape_scan_sse2},
+		{"avx2", escape_scan_avx2},
+#endif
+		{"dispatch", select_escape_scan()},
+	};
+	pass_timing_t pass;
+	char *reference, *output;
+	size_t reference_size, output_size = 0;
+	double start;
+	int i, round, status = 1;
+
+	reference = malloc(corpus_size * 5 + 1);
+	output = malloc(corpus_size * 5 + 1);
+	if (reference == NULL || output == NULL)
+	{
+		free(reference);
+		free(output);
+		fprintf(stderr, "Error! could not allocate the escape buffers\n");
+		return 0;
+	}
+	reference_size = escape_bytewise(corpus, corpus_size, reference);
+
+	for (i = 0; i < (int)(sizeof(kernels) / sizeof(kernels[0])) && status; i++)
+	{
+#ifdef ESCAPE_HAVE_X86_KERNELS
+		if (kernels[i].scan == escape_scan_avx2 && !__builtin_cpu_supports("avx2"))
+			continue;
+#endif
+		for (round = 0; round < BENCH_REPEAT; round++)
+		{
+			start = now_seconds();
+			if (kernels[i].scan)
+				output_size = escape_with_kernel(kernels[i].scan, corpus, corpus_size, output);
+			else
+				output_size = escape_bytewise(corpus, corpus_size, output);
+			start = now_seconds() - start;
+			if (round == 0 || start < pass.seconds)
+				pass.seconds = start;
+		}
+		if (output_size != reference_size || memcmp(output, reference, output_size) != 0)
+		{
+			fprintf(stderr, "ERROR: kernel %s output differs from the bytewise reference\n", kernels[i].name);
+			status = 0;
+			break;
+		}
+		pass.name = kernels[i].name;
+		report_pass(report, corpus_name, corpus_size, 0, &pass);
+	}
+	free(reference);
+	free(output);
+	return status;
+}
+
+/* Emits the table through convert_token_to_html, one token view at a time, the way the streaming converter does */
+static void emit_table_tokens(output_buffer_t *output, const token_table_t *table, const char *source_data, int enable_line_numbers)
+{
+	s2html_emitter_t emitter;
+	parser_token_t token;
+	size_t i;
+
+	init_emitter(&emitter, output, enable_line_numbers);
+	generate_html_header(&emitter, HTML_DOCUMENT_START);
+	for (i = 0; i < table->count; i++)
+	{
+		token.type = table->types[i];
+		token.attribute = table->attributes[i];
+		token.content = source_data + table->offsets[i];
+		token.size = table->lengths[i];
+		convert_token_to_html(&emitter, &token);
+	}
+	generate_html_footer(&emitter, HTML_DOCUMENT_END);
+}
+
+/*
+ * Times extract_next_token on its own, with the state handlers and with the generated transition table, then
+ * convert_token_to_html on its own (fed from a token table so no lexing is timed), with and without line numbers. The
+ * table driven tokens are checked against the handlers' and both emit passes against convert_source_to_html. Returns 0
+ * on mismatch or allocation failure.
+ */
+static int bench_token_passes(bench_report_t *report, const char *corpus_name, const char *corpus, size_t corpus_size)
+{
+	source_buffer_t source;
+	s2html_lexer_t lexer;
+	token_table_t table;
+	output_buffer_t reference, output;
+	pass_timing_t pass;
+	parser_token_t *token;
+	size_t tokens = 0;
+	double start;
+	int round, numbered, status = 1;
+
+	if (!init_token_table(&table, corpus_size / 4))
+	{
+		fprintf(stderr, "Error! could not allocate the token table\n");
+		return 0;
+	}
+	open_source_memory(&source, corpus, corpus_size);
+	if (!lex_source_to_table(&source, &table))
+	{
+		free_token_table(&table);
+		fprintf(stderr, "Error! could not allocate the token table\n");
+		return 0;
+	}
+
+	pass.name = "lex";
+	for (round = 0; round < BENCH_REPEAT; round++)
+	{
+		open_source_memory(&source, corpus, corpus_size);
+		init_lexer(&lexer, &source);
+		start = now_seconds();
+		for (tokens = 1; extract_next_token(&lexer)->type != TOKEN_END_OF_FILE; tokens++)
+			;
+		start = now_seconds() - start;
+		if (round == 0 || start < pass.seconds)
+			pass.seconds = start;
+	}
+	report_pass(report, corpus_name, corpus_size, tokens, &pass);
+
+	open_source_memory(&source, corpus, corpus_size);
+	init_lexer(&lexer, &source);
+	lexer.table_driven = 1;
+	for (tokens = 0; tokens < table.count; tokens++)
+	{
+		token = extract_next_token(&lexer);
+		if (token->type != table.types[tokens] || token->attribute != table.attributes[tokens] || token->size != table.lengths[tokens] ||
+			(token->size && (size_t)(token->content - corpus) != table.offsets[tokens]))
+			break;
+	}
+	if (tokens != table.count)
+	{
+		fprintf(stderr, "ERROR: lex_dfa token %zu of corpus %s differs from the state handlers'\n", tokens, corpus_name);
+		free_token_table(&table);
+		return 0;
+	}
+	pass.name = "lex_dfa";
+	for (round = 0; round < BENCH_REPEAT; round++)
+	{
+		open_source_memory(&source, corpus, corpus_size);
+		init_lexer(&lexer, &source);
+		lexer.table_driven = 1;
+		start = now_seconds();
+		for (tokens = 1; extract_next_token(&lexer)->type != TOKEN_END_OF_FILE; tokens++)
+			;
+		start = now_seconds() - start;
+		if (round == 0 || start < pass.seconds)
+			pass.seconds = start;
+	}
+	report_pass(report, corpus_name, corpus_size, tokens, &pass);
+
+	for (numbered = 0; numbered <= 1 && status; numbered++)
+	{
+		if (!open_memory_output_buffer(&reference) || !open_memory_output_buffer(&output))
+		{
+			fprintf(stderr, "Error! could not allocate the output buffers\n");
+			status = 0;
+			break;
+		}
+		open_source_memory(&source, corpus, corpus_size);
+		convert_source_to_html(&source, &reference, numbered);
+
+		pass.name = numbered ? "emit_n" : "emit";
+		for (round = 0; round < BENCH_REPEAT; round++)
+		{
+			output.length = 0;
+			start = now_seconds();
+			emit_table_tokens(&output, &table, corpus, numbered);
+			start = now_seconds() - start;
+			if (round == 0 || start < pass.seconds)
+				pass.seconds = start;
+		}
+
+		if (output.error || reference.error || output.length != reference.length || memcmp(output.data, reference.data, output.length) != 0)
+		{
+			fprintf(stderr, "ERROR: %s output of corpus %s differs from the interleaved conversion\n", pass.name, corpus_name);
+			status = 0;
+		}
+		else
+		{
+			report_pass(report, corpus_name, corpus_size, table.count, &pass);
+		}
+		close_output_buffer(&reference);
+		close_output_buffer(&output);
+	}
+
+	free_token_table(&table);
+	return status;
+}
+
+static void print_usage(void)
+{
+	printf("Usage: <executable> [--size <MB>] [--mix <name|all>] [--seed <n>] [--json] [--write-corpus <file>] [sample file]\n");
+	printf("  --size : Bytes per corpus in MB (default %d)\n", DEFAULT_CORPUS_MEGABYTES);
+	printf("  --mix : Generated corpus to run: comment, string, preprocessor, identifier, mixed or all (default all)\n");
+	printf("  --seed : Generator seed, the same seed always produces the same corpus (default %d)\n", DEFAULT_CORPUS_SEED);
+	printf("  --json : Print the results as JSON for comparing runs\n");
+	printf("  --write-corpus : Write the generated corpus to this file and exit (needs a single --mix)\n");
+	printf("  sample file : Benchmark this file scaled to --size instead of generated corpora\n");
+	printf("Example : ./s2html_bench --size 32 --json > baseline.json\n");
+	printf("Example : ./s2html_bench --mix comment --size 8 --write-corpus comments.c\n");
+	printf("Example : ./s2html_bench --size 100 test\n");
+}
+
+/* Runs every benchmark over one corpus; returns 0 on failure */
+static int bench_corpus(bench_report_t *report, const char *corpus_name, const char *corpus, size_t corpus_size)
+{
+	return bench_escape_kernels(report, corpus_name, corpus, corpus_size)
+		&& bench_token_passes(report, corpus_name, corpus, corpus_size);
+}
+
+/* ********************************************************************************************************************** */
+/* ********************************************************************************************************************** */
+
+/********** benchmark entry point **********/
+
+int main(int argc, char *argv[])
+{
+	source_buffer_t sample;
+	output_buffer_t corpus;
+	bench_report_t report = {0, 1};
+	const char *mix_name = "all", *sample_path = NULL, *corpus_path = NULL;
+	unsigned long long seed = DEFAULT_CORPUS_SEED;
+	int megabytes = DEFAULT_CORPUS_MEGABYTES;
+	int i, matched = 0, status = 1;
+	size_t corpus_size;
+	FILE *corpus_stream;
+
+	for (i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+			megabytes = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--mix") == 0 && i + 1 < argc)
+			mix_name = argv[++i];
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+			seed = strtoull(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--json") == 0)
+			report.json = 1;
+		else if (strcmp(argv[i], "--write-corpus") == 0 && i + 1 < argc)
+			corpus_path = argv[++i];
+		else if (argv[i][0] != '-' && sample_path == NULL)
+			sample_path = argv[i];
+		else
+		{
+			print_usage();
+			return 1;
+		}
+	}
+	if (megabytes < 1)
+	{
+		print_usage();
+		return 1;
+	}
+	corpus_size = (size_t)megabytes << 20;
+
+	if (corpus_path)
+		; /* corpus generator only, no report */
+	else if (report.json)
+		printf("{\n  \"format\": %d,\n  \"escape_kernel\": \"%s\",\n  \"repeat\": %d,\n  \"seed\": %llu,\n  \"results\": [",
+			   BENCH_JSON_VERSION, escape_scan_kernel_name(), BENCH_REPEAT, seed);
+	else
+		printf("%-14s %-10s %10s %10s %12s\n", "corpus", "pass", "seconds", "MB/s", "tokens/s");
+
+	if (sample_path)
+	{
+		if (!open_source_buffer(&sample, sample_path))
+		{
+			fprintf(stderr, "Error! File %s could not be opened\n", sample_path);
+			return 2;
+		}
+		if (!build_sample_corpus(&corpus, sample.data, sample.length, corpus_size))
+		{
+			fprintf(stderr, "Error! could not allocate %d MB corpus\n", megabytes);
+			return 3;
+		}
+		status = bench_corpus(&report, "sample", corpus.data, corpus.length);
+		close_output_buffer(&corpus);
+		close_source_buffer(&sample);
+	}
+	else
+	{
+		for (i = 0; i < (int)(sizeof(corpus_mixes) / sizeof(corpus_mixes[0])) && status; i++)
+		{
+			if (strcmp(mix_name, "all") != 0 && strcmp(mix_name, corpus_mixes[i].name) != 0)
+				continue;
+			matched++;
+			if (!generate_corpus(&corpus, &corpus_mixes[i], corpus_size, seed))
+			{
+				fprintf(stderr, "Error! could not allocate %d MB corpus\n", megabytes);
+				return 3;
+			}
+			if (corpus_path)
+			{
+				if (strcmp(mix_name, "all") == 0 || NULL == (corpus_stream = fopen(corpus_path, "w")))
+				{
+					fprintf(stderr, "Error! could not write the %s corpus to %s\n", corpus_mixes[i].name, corpus_path ? corpus_path : "");
+					return 2;
+				}
+				status = fwrite(corpus.data, 1, corpus.length, corpus_stream) == corpus.length;
+				status = fclose(corpus_stream) == 0 && status;
+				close_output_buffer(&corpus);
+				return status ? 0 : 2;
+			}
+			status = bench_corpus(&report, corpus_mixes[i].name, corpus.data, corpus.length);
+			close_output_buffer(&corpus);
+		}
+		if (matched == 0)
+		{
+			fprintf(stderr, "Error! unknown corpus mix %s\n", mix_name);
+			return 1;
+		}
+	}
+
+	if (report.json)
+		printf("\n  ]\n}\n");
+	return status ? 0 : 4;
+}
@@ -0,0 +1,324 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include "s2html_event.h"
+#include "s2html_conv.h"
+#include "s2html_cache.h"
+#include "s2html_theme.h"
+
+#define CACHE_KEY_LENGTH		32		/* hex digits of the 128 bit key */
+#define CACHE_ENTRY_SUFFIX		".html"
+#define CACHE_ENTRY_INITIAL_CAPACITY	256
+
+/*
+ * An entry is named after a 128 bit hash of the input bytes, seeded with the cache format version and the options.
+ * Entries are never modified once renamed into place, so a hit only has to copy or link the file. Recency is the
+ * entry's modification time, refreshed on every hit; eviction removes the oldest entries first.
+ */
+
+typedef struct
+{
+	char name[CACHE_KEY_LENGTH + sizeof(CACHE_ENTRY_SUFFIX)];
+	time_t last_used;
+	unsigned long long size;
+}cache_entry_t;
+
+/********** Helper function implementations **********/
+
+static inline unsigned long long rotate_left(unsigned long long value, int count)
+{
+	return (value << count) | (value >> (64 - count));
+}
+
+/* Final avalanche of a 64 bit lane */
+static inline unsigned long long mix_lane(unsigned long long value)
+{
+	value ^= value >> 33;
+	value *= 0xff51afd7ed558ccdULL;
+	value ^= value >> 33;
+	value *= 0xc4ceb9fe1a85ec53ULL;
+	return value ^ (value >> 33);
+}
+
+/* 128 bit key of data: two multiply-rotate lanes over 8 byte words (fast, not cryptographic) */
+static void hash_content(const char *data, size_t length, unsigned long long seed, unsigned long long key[2])
+{
+	unsigned long long first = seed ^ 0x9e3779b97f4a7c15ULL, second = mix_lane(seed) ^ 0xc2b2ae3d27d4eb4fULL, word;
+	size_t i;
+
+	for (i = 0; i + 8 <= length; i += 8)
+	{
+		memcpy(&word, data + i, 8);
+		first = rotate_left(first ^ (word * 0x87c37b91114253d5ULL), 31) * 0x4cf5ad432745937fULL;
+		second = rotate_left(second + word, 27) * 0x9e3779b97f4a7c15ULL + first;
+	}
+	word = 0;
+	if (i < length)
+		memcpy(&word, data + i, length - i);
+	first = rotate_left(first ^ (word * 0x87c37b91114253d5ULL), 31) * 0x4cf5ad432745937fULL;
+	second = rotate_left(second + word, 27) * 0x9e3779b97f4a7c15ULL + first;
+
+	key[0] = mix_lane(first ^ length);
+	key[1] = mix_lane(second ^ key[0]);
+}
+
+/* Every option that changes the generated HTML must be part of the seed, and so must the theme an entry embeds; the
+   CONVERT_ENGINE_FLAGS do not change it, so both lexers share entries */
+static unsigned long long options_seed(int options)
+{
+	unsigned long long seed;
+
+	options &= ~CONVERT_ENGINE_FLAGS;
+	seed = mix_lane(((unsigned long long)CACHE_FORMAT_VERSION << 32) | (unsigned int)options);
+	return (options & CONVERT_EMBED_CSS) ? mix_lane(seed ^ THEME_HASH) : seed;
+}
+
+static int is_entry_name(const char *name)
+{
+	size_t length = strlen(name);
+	return length == CACHE_KEY_LENGTH + sizeof(CACHE_ENTRY_SUFFIX) - 1 && strcmp(name + CACHE_KEY_LENGTH, CACHE_ENTRY_SUFFIX) == 0;
+}
+
+static int compare_entries_by_use(const void *first, const void *second)
+{
+	const cache_entry_t *a = first, *b = second;
+	return (a->last_used > b->last_used) - (a->last_used < b->last_used);
+}
+
+/* Lists the entries of the cache directory; returns NULL when it cannot be read */
+static cache_entry_t *scan_entries(const conversion_cache_t *cache, size_t *entry_count, unsigned long long *total_bytes)
+{
+	char path[CACHE_PATH_LENGTH];
+	cache_entry_t *entries, *grown;
+	size_t capacity = CACHE_ENTRY_INITIAL_CAPACITY;
+	struct dirent *item;
+	struct stat status;
+	DIR *directory;
+
+	*entry_count = 0;
+	*total_bytes = 0;
+	if (NULL == (directory = opendir(cache->directory)))
+		return NULL;
+	if (NULL == (entries = malloc(capacity * sizeof(*entries))))
+	{
+		closedir(directory);
+		return NULL;
+	}
+
+	while ((item = readdir(directory)) != NULL)
+	{
+		if (!is_entry_name(item->d_name))
+			continue;
+		snprintf(path, sizeof(path), "%s/%s", cache->directory, item->d_name);
+		if (stat(path, &status) != 0)
+			continue; /* evicted by another process meanwhile */
+		if (*entry_count == capacity)
+		{
+			if (NULL == (grown = realloc(entries, capacity * 2 * sizeof(*entries))))
+				break;
+			entries = grown;
+			capacity *= 2;
+		}
+		strcpy(entries[*entry_count].name, item->d_name);
+		entries[*entry_count].last_used = status.st_mtime;
+		entries[*entry_count].size = status.st_size;
+		*total_bytes += status.st_size;
+		(*entry_count)++;
+	}
+	closedir(directory);
+	return entries;
+}
+
+/* Removes least recently used entries until the cache is at its low water mark; caller holds the lock */
+static void evict_entries(conversion_cache_t *cache)
+{
+	char path[CACHE_PATH_LENGTH];
+	unsigned long long low_water = cache->max_bytes / 100 * CACHE_LOW_WATER_PERCENT;
+	cache_entry_t *entries;
+	size_t entry_count, i;
+
+	/* The directory is the truth: other processes may share the cache */
+	if (NULL == (entries = scan_entries(cache, &entry_count, &cache->total_bytes)))
+		return;
+	qsort(entries, entry_count, sizeof(*entries), compare_entries_by_use);
+	for (i = 0; i < entry_count && cache->total_bytes > low_water; i++)
+	{
+		snprintf(path, sizeof(path), "%s/%s", cache->directory, entries[i].name);
+		if (unlink(path) != 0)
+			continue;
+		cache->total_bytes -= entries[i].size;
+		cache->stats.evictions++;
+		cache->stats.evicted_bytes += entries[i].size;
+	}
+	free(entries);
+}
+
+/* Copies the file at from_path to to_path; returns 0 on failure */
+static int copy_file(const char *from_path, const char *to_path)
+{
+	source_buffer_t from;
+	FILE *to;
+	int ok;
+
+	if (!open_source_buffer(&from, from_path))
+		return 0;
+	if (NULL == (to = fopen(to_path, "w")))
+	{
+		close_source_buffer(&from);
+		return 0;
+	}
+	ok = fwrite(from.data, 1, from.length, to) == from.length;
+	ok = fclose(to) == 0 && ok;
+	close_source_buffer(&from);
+	return ok;
+}
+
+/* Puts the entry at entry_path in place as output_path; returns 0 if the entry is gone or cannot be used */
+static int serve_entry(const conversion_cache_t *cache, const char *entry_path, const char *output_path)
+{
+	if (access(entry_path, R_OK) != 0)
+		return 0;
+	/* Never write through an output linked by an earlier run: that would change the entry sharing its inode */
+	unlink(output_path);
+	if (cache->link_entries && link(entry_path, output_path) == 0)
+		return 1;
+	return copy_file(entry_path, output_path);
+}
+
+/* Converts source into a new entry at entry_path, with the output buffers cut from arena when it is not NULL, and puts
+   it in place as output_path; sets stored_bytes to the size of the entry if this call created it, 0 if an identical
+   entry was already there. Returns NULL on success or a description of the failure */
+static const char *store_entry(conversion_cache_t *cache, source_buffer_t *source, const char *entry_path, const char *output_path, int options,
+							   arena_t *arena, unsigned long long *stored_bytes)
+{
+	char temporary_path[CACHE_PATH_LENGTH];
+	output_buffer_t destination;
+	FILE *destination_stream;
+	struct stat status;
+	const char *error = NULL;
+	int descriptor;
+
+	*stored_bytes = 0;
+	snprintf(temporary_path, sizeof(temporary_path), "%s/.tmp-XXXXXX", cache->directory);
+	if ((descriptor = mkstemp(temporary_path)) < 0)
+		return "could not create cache entry";
+	if (NULL == (destination_stream = fdopen(descriptor, "w")))
+	{
+		close(descriptor);
+		unlink(temporary_path);
+		return "could not create cache entry";
+	}
+	if (arena ? !open_arena_output_buffer(&destination, destination_stream, arena) : !open_output_buffer(&destination, destination_stream))
+	{
+		error = "could not allocate output buffer";
+	}
+	else
+	{
+		convert_source_to_html(source, &destination, options);
+		if (!close_output_buffer(&destination))
+			error = "could not write cache entry";
+	}
+	if (fclose(destination_stream) != 0 && error == NULL)
+		error = "could not write cache entry";
+	if (error == NULL)
+		chmod(temporary_path, 0644); /* mkstemp creates 0600, the HTML may be shared by linking */
+
+	/* Served before it becomes an entry, which another worker's eviction could remove at once */
+	if (error == NULL && !serve_entry(cache, temporary_path, output_path))
+		error = "could not write output file";
+
+	/* Linking fails if the entry exists, so of two workers converting the same input only the first adds its size; the
+	   other drops its identical file */
+	if (error == NULL && stat(temporary_path, &status) != 0)
+		error = "could not store cache entry";
+	if (error == NULL && link(temporary_path, entry_path) == 0)
+		*stored_bytes = status.st_size;
+	else if (error == NULL && errno != EEXIST)
+	{
+		/* A file system without hard links: rename over any existing entry, counted as new until the next rescan */
+		if (rename(temporary_path, entry_path) == 0)
+		{
+			*stored_bytes = status.st_size;
+			return NULL;
+		}
+		error = "could not store cache entry";
+	}
+	unlink(temporary_path);
+	return error;
+}
+
+/* ********************************************************************************************************************** */
+/* ********************************************************************************************************************** */
+
+/* Opens (creating if needed) the cache in directory; returns 0 if it cannot be used */
+int open_conversion_cache(conversion_cache_t *cache, const char *directory, unsigned long long max_bytes, int link_entries)
+{
+	cache_entry_t *entries;
+	size_t entry_count;
+
+	memset(cache, 0, sizeof(*cache));
+	cache->directory = directory;
+	cache->max_bytes = max_bytes ? max_bytes : CACHE_DEFAULT_MAX_BYTES;
+	cache->link_entries = link_entries;
+
+	mkdir(directory, 0777); /* EEXIST is expected, other failures surface in the scan */
+	if (NULL == (entries = scan_entries(cache, &entry_count, &cache->total_bytes)))
+		return 0;
+	free(entries);
+	pthread_mutex_init(&cache->lock, NULL);
+	if (cache->total_bytes > cache->max_bytes)
+		evict_entries(cache);
+	return 1;
+}
+
+void close_conversion_cache(conversion_cache_t *cache)
+{
+	pthread_mutex_destroy(&cache->lock);
+}
+
+/* Converts one file through the cache, with the output buffers of a miss cut from arena when it is not NULL; returns
+   NULL on success or a description of the failure */
+const char *convert_file_cached(conversion_cache_t *cache, const char *input_path, const char *output_path, int options, arena_t *arena)
+{
+	char entry_path[CACHE_PATH_LENGTH];
+	unsigned long long key[2];
+	source_buffer_t source;
+	unsigned long long stored_bytes;
+	const char *error = NULL;
+
+	if (!open_source_buffer(&source, input_path))
+		return "could not be opened";
+	hash_content(source.data, source.length, options_seed(options), key);
+	if (snprintf(entry_path, sizeof(entry_path), "%s/%016llx%016llx%s", cache->directory, key[0], key[1], CACHE_ENTRY_SUFFIX) >= (int)sizeof(entry_path))
+	{
+		close_source_buffer(&source);
+		return "cache path too long";
+	}
+
+	if (serve_entry(cache, entry_path, output_path))
+	{
+		utime(entry_path, NULL); /* most recently used */
+		pthread_mutex_lock(&cache->lock);
+		cache->stats.hits++;
+		pthread_mutex_unlock(&cache->lock);
+		close_source_buffer(&source);
+		return NULL;
+	}
+
+	error = store_entry(cache, &source, entry_path, output_path, options, arena, &stored_bytes);
+	close_source_buffer(&source);
+
+	/* The running total only grows by entries this process created; the directory is rescanned once it passes the bound */
+	pthread_mutex_lock(&cache->lock);
+	cache->stats.misses++;
+	cache->total_bytes += stored_bytes;
+	if (cache->total_bytes > cache->max_bytes)
+		evict_entries(cache);
+	pthread_mutex_unlock(&cache->lock);
+	return error;
+}
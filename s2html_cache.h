@@ -0,0 +1,38 @@
+#ifndef S2HTML_CACHE_H
+#define S2HTML_CACHE_H
+
+#include <pthread.h>
+#include "s2html_arena.h"
+
+#define CACHE_FORMAT_VERSION		1		/* bump whenever the generated HTML changes, so old entries stop matching */
+#define CACHE_DEFAULT_MAX_BYTES		(256ULL * 1024 * 1024)
+#define CACHE_LOW_WATER_PERCENT		90		/* eviction trims the cache to this share of its bound */
+#define CACHE_PATH_LENGTH			4096
+
+typedef struct
+{
+	unsigned long hits;			// inputs served from the cache
+	unsigned long misses;		// inputs converted and stored
+	unsigned long evictions;	// entries removed to stay under the size bound
+	unsigned long long evicted_bytes;
+}cache_stats_t;
+
+/* On-disk cache of converted HTML, keyed by a hash of the input bytes and every option that changes the HTML */
+typedef struct
+{
+	const char *directory;			// entries live here as <key>.html
+	unsigned long long max_bytes;	// bound on the total size of the entries
+	int link_entries;				// non-zero => hard-link hits into place instead of copying them
+	unsigned long long total_bytes;	// current size of the entries
+	cache_stats_t stats;
+	pthread_mutex_t lock;			// guards total_bytes, stats and eviction
+}conversion_cache_t;
+
+/********** function prototypes **********/
+
+int open_conversion_cache(conversion_cache_t *cache, const char *directory, unsigned long long max_bytes, int link_entries);
+void close_conversion_cache(conversion_cache_t *cache);
+const char *convert_file_cached(conversion_cache_t *cache, const char *input_path, const char *output_path, int options, arena_t *arena);
+
+#endif
+/**** End of file ****/
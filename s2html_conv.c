@@ -1,161 +1,551 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "s2html_event.h"
+#include "s2html_escape.h"
 #include "s2html_conv.h"
+#include "s2html_stats.h"
+#include "s2html_lineindex.h"
+#include "s2html_theme.h"
 
-/* Static variable to track current line number */
-static int current_line_number = 1;
-static int line_number_enabled = 0;
-static int line_start = 1; /* Flag to track if we're at the start of a line */
+/* Style classes of the markup, as bits of s2html_emitter_t.used_classes; STYLE_NONE is text written without a span */
+enum
+{
+#define STYLE_CLASS(style, class_name, compact_name) style,
+#include "s2html_styles.def"
+#undef STYLE_CLASS
+	STYLE_CLASS_COUNT,
+	STYLE_NONE = STYLE_CLASS_COUNT
+};
+
+#define STYLE_BIT(style)		(1u << (style))
+
+/* Class names, indexed by [compact][style] */
+static const char *const style_class_names[2][STYLE_CLASS_COUNT] = {
+	{
+#define STYLE_CLASS(style, class_name, compact_name) [style] = class_name,
+#include "s2html_styles.def"
+#undef STYLE_CLASS
+	},
+	{
+#define STYLE_CLASS(style, class_name, compact_name) [style] = compact_name,
+#include "s2html_styles.def"
+#undef STYLE_CLASS
+	},
+};
+
+/* Span markup written around a token's escaped content */
+typedef struct
+{
+	const char *prefix;
+	size_t prefix_length;
+	const char *suffix;
+	size_t suffix_length;
+	unsigned int style_bit;		// STYLE_BIT of the span's class, 0 without a span
+}span_markup_t;
+
+#define SPAN_MARKUP(style, class_name)	{ OUTPUT_LITERAL("<span class=\"" class_name "\">"), OUTPUT_LITERAL("</span>"), STYLE_BIT(style) }
+#define NO_MARKUP						{ OUTPUT_LITERAL(""), OUTPUT_LITERAL(""), 0 }
+
+/* Markup per style, indexed by [compact][style] like the names */
+static const span_markup_t style_markup[2][STYLE_CLASS_COUNT + 1] = {
+	{
+#define STYLE_CLASS(style, class_name, compact_name) [style] = SPAN_MARKUP(style, class_name),
+#include "s2html_styles.def"
+#undef STYLE_CLASS
+		[STYLE_NONE] = NO_MARKUP,
+	},
+	{
+#define STYLE_CLASS(style, class_name, compact_name) [style] = SPAN_MARKUP(style, compact_name),
+#include "s2html_styles.def"
+#undef STYLE_CLASS
+		[STYLE_NONE] = NO_MARKUP,
+	},
+};
+
+/* Style per token type; header files and keywords have attribute dependent variants in emit_token */
+static const unsigned char token_style[] = {
+	[TOKEN_PREPROCESSOR_DIRECTIVE] = STYLE_PREPROCESS_DIR,
+	[TOKEN_RESERVE_KEYWORD] = STYLE_RESERVED_KEY1,
+	[TOKEN_NUMERIC_CONSTANT] = STYLE_NUMERIC_CONSTANT,
+	[TOKEN_STRING_LITERAL] = STYLE_STRING,
+	[TOKEN_HEADER_FILE] = STYLE_HEADER_FILE,
+	[TOKEN_REGULAR_TEXT] = STYLE_NONE,
+	[TOKEN_SINGLE_LINE_COMMENT] = STYLE_COMMENT,
+	[TOKEN_MULTI_LINE_COMMENT] = STYLE_COMMENT,
+	[TOKEN_ASCII_CHAR] = STYLE_ASCII_CHAR,
+	[TOKEN_FORMAT_SPECIFIER] = STYLE_FORMAT_SPECIFIER,
+	[TOKEN_OPERATORS] = STYLE_OPERATORS,
+	[TOKEN_SYMBOL] = STYLE_SYMBOLS,
+	[TOKEN_END_OF_FILE] = STYLE_NONE,
+};
+
+#define LINE_NUMBER_SUFFIX		"</span> "
+#define LINE_NUMBER_WIDTH		4
+
+/* Prepares emitter to write one document into output; options are CONVERT_* flags */
+void init_emitter(s2html_emitter_t *emitter, output_buffer_t *output, int options)
+{
+	emitter->output = output;
+	emitter->line_number_enabled = options & CONVERT_LINE_NUMBERS;
+	emitter->current_line_number = 1;
+	emitter->line_start = 1;
+	emitter->deferred_gutters = NULL;
+	emitter->embed_css = (options & CONVERT_EMBED_CSS) != 0;
+	emitter->compact = (options & CONVERT_COMPACT) != 0;
+	emitter->escape_scan = (options & CONVERT_SCALAR_ESCAPE) ? escape_scan_scalar : select_escape_scan();
+	emitter->used_classes = 0;
+	emitter->open_style_bit = 0;
+	emitter->options = options;
+	emitter->next_page_line = 0;
+	emitter->page_break = NULL;
+	emitter->page_context = NULL;
+	emitter->line_index = NULL;
+	emitter->source = NULL;
+	emitter->stats = NULL;
+}
+
+/* Writes a <style> element with the compiled in theme rules a document with used_classes needs, renaming the class
+   selectors for compact documents */
+static void append_embedded_theme(output_buffer_t *output, unsigned int used_classes, int compact)
+{
+	size_t selector_length;
+	int rule, style;
+
+	output_append(output, OUTPUT_LITERAL("<style>\n"));
+	for (rule = 0; rule < THEME_RULE_COUNT; rule++)
+	{
+		if (theme_rules[rule].style_class == NULL)
+		{
+			output_append(output, theme_rules[rule].css, theme_rules[rule].length);
+			output_append_char(output, '\n');
+			continue;
+		}
+		for (style = 0; style < STYLE_CLASS_COUNT && strcmp(style_class_names[0][style], theme_rules[rule].style_class) != 0; style++)
+			;
+		if (style == STYLE_CLASS_COUNT || !(used_classes & STYLE_BIT(style)))
+			continue; /* a class no span of this document has */
+		selector_length = strlen(theme_rules[rule].style_class) + 1;
+		output_append_char(output, '.');
+		output_append(output, style_class_names[compact][style], strlen(style_class_names[compact][style]));
+		output_append(output, theme_rules[rule].css + selector_length, theme_rules[rule].length - selector_length);
+		output_append_char(output, '\n');
+	}
+	output_append(output, OUTPUT_LITERAL("</style>\n"));
+}
 
 /* HTML document structure generation functions */
-void generate_html_header(FILE* output_file, int mode) /* mode parameter for future extensibility */
+void generate_html_header(s2html_emitter_t *emitter, int mode) /* mode parameter for future extensibility */
 {
 	/* Write HTML document opening structure */
-	fprintf(output_file, "<!DOCTYPE html>\n");
-	fprintf(output_file, "<html lang=\"en-US\">\n");
-	fprintf(output_file, "<head>\n");
-	fprintf(output_file, "<title>%s</title>\n", "sode2html");
-	fprintf(output_file, "<meta charset=\"UTF-8\">\n");
-	fprintf(output_file, "<link rel=\"stylesheet\" href=\"styles.css\">\n");
-	fprintf(output_file, "</head>\n");
-	fprintf(output_file, "<body>\n");
-	fprintf(output_file, "<div class=\"code-container\">\n");
-	fprintf(output_file, "<pre>\n");
+	output_append(emitter->output, OUTPUT_LITERAL("<!DOCTYPE html>\n"
+										 "<html lang=\"en-US\">\n"
+										 "<head>\n"
+										 "<title>sode2html</title>\n"
+										 "<meta charset=\"UTF-8\">\n"));
+	if (emitter->embed_css)
+		append_embedded_theme(emitter->output, emitter->used_classes | STYLE_BIT(STYLE_CODE_CONTAINER) |
+							  (emitter->line_number_enabled ? STYLE_BIT(STYLE_LINE_NUMBER) : 0), emitter->compact);
+	else if (emitter->compact)
+		output_append(emitter->output, OUTPUT_LITERAL("<link rel=\"stylesheet\" href=\"styles-compact.css\">\n"));
+	else
+		output_append(emitter->output, OUTPUT_LITERAL("<link rel=\"stylesheet\" href=\"styles.css\">\n"));
+	output_append(emitter->output, OUTPUT_LITERAL("</head>\n"
+										 "<body>\n"
+										 "<div class=\"code-container\">\n"
+										 "<pre>\n"));
 	
 	/* Reset line number counter */
-	current_line_number = 1;
-	line_start = 1;
+	emitter->current_line_number = 1;
+	emitter->line_start = 1;
 }
 
-void generate_html_footer(FILE* output_file, int mode) /* mode parameter for future extensibility */
+void generate_html_footer(s2html_emitter_t *emitter, int mode) /* mode parameter for future extensibility */
 {
 	/* Write HTML document closing structure */
-	fprintf(output_file, "</pre>\n");
-	fprintf(output_file, "</div>\n");
-	fprintf(output_file, "</body>\n");
-	fprintf(output_file, "</html>\n");
+	output_append(emitter->output, OUTPUT_LITERAL("</pre>\n"
+										 "</div>\n"
+										 "</body>\n"
+										 "</html>\n"));
+}
+
+/* Writes the gutter span of line_number, right aligned like "%4d"; CONVERT_COMPACT and CONVERT_LINE_ANCHORS in options
+   choose the class name and add an id */
+void append_line_number(output_buffer_t *output, int line_number, int options)
+{
+	const span_markup_t *gutter = &style_markup[(options & CONVERT_COMPACT) != 0][STYLE_LINE_NUMBER];
+	const char *class_name;
+	char digits[16];
+	int index = sizeof(digits), first_digit, value = line_number;
+
+	do
+	{
+		digits[--index] = '0' + value % 10;
+		value /= 10;
+	} while (value > 0);
+	first_digit = index;
+	while ((int)sizeof(digits) - index < LINE_NUMBER_WIDTH)
+		digits[--index] = ' ';
+
+	if (options & CONVERT_LINE_ANCHORS)
+	{
+		class_name = style_class_names[(options & CONVERT_COMPACT) != 0][STYLE_LINE_NUMBER];
+		output_append(output, OUTPUT_LITERAL("<span id=\"L"));
+		output_append(output, digits + first_digit, sizeof(digits) - first_digit);
+		output_append(output, OUTPUT_LITERAL("\" class=\""));
+		output_append(output, class_name, strlen(class_name));
+		output_append(output, OUTPUT_LITERAL("\">"));
+	}
+	else
+	{
+		output_append(output, gutter->prefix, gutter->prefix_length);
+	}
+	output_append(output, digits + index, sizeof(digits) - index);
+	output_append(output, OUTPUT_LITERAL(LINE_NUMBER_SUFFIX));
+}
+
+/* Style classes of the spans in length bytes of emitter HTML (compact class names if compact is set), for a document
+   assembled from several emitters' output. Source bytes are always escaped, so every "<span class=" is one of ours. */
+unsigned int collect_style_classes(const char *html, size_t length, int compact)
+{
+	static const char span_prefix[] = "<span class=\"";
+	const char *end = html + length, *name, *name_end;
+	unsigned int used_classes = 0;
+	int style;
+
+	while (NULL != (html = memchr(html, '<', end - html)))
+	{
+		if ((size_t)(end - html) < sizeof(span_prefix) - 1 || memcmp(html, span_prefix, sizeof(span_prefix) - 1) != 0)
+		{
+			html++;
+			continue;
+		}
+		name = html + sizeof(span_prefix) - 1;
+		if (NULL == (name_end = memchr(name, '"', end - name)))
+			break;
+		for (style = 0; style < STYLE_CLASS_COUNT; style++)
+		{
+			if ((size_t)(name_end - name) == strlen(style_class_names[compact][style]) && memcmp(name, style_class_names[compact][style], name_end - name) == 0)
+			{
+				used_classes |= STYLE_BIT(style);
+				break;
+			}
+		}
+		html = name_end;
+	}
+	return used_classes;
+}
+
+/* Copies length bytes of HTML written by an emitter (without --compact) to output, adding delta to every gutter number
+   in it. Source bytes are always escaped, so the gutter prefix can only be one of ours. */
+void append_renumbered_html(output_buffer_t *output, const char *html, size_t length, int delta)
+{
+	const span_markup_t *prefix = &style_markup[0][STYLE_LINE_NUMBER];
+	const char *end = html + length, *gutter;
+	int line_number;
+
+	while (delta != 0 && NULL != (gutter = memchr(html, '<', end - html)))
+	{
+		if ((size_t)(end - gutter) < prefix->prefix_length || memcmp(gutter, prefix->prefix, prefix->prefix_length) != 0)
+		{
+			output_append(output, html, gutter + 1 - html);
+			html = gutter + 1;
+			continue;
+		}
+		output_append(output, html, gutter - html);
+		html = gutter + prefix->prefix_length;
+		while (html < end && *html == ' ')
+			html++;
+		for (line_number = 0; html < end && *html >= '0' && *html <= '9'; html++)
+			line_number = line_number * 10 + (*html - '0');
+		html = (size_t)(end - html) < sizeof(LINE_NUMBER_SUFFIX) - 1 ? end : html + sizeof(LINE_NUMBER_SUFFIX) - 1;
+		append_line_number(output, line_number + delta, 0);
+	}
+	output_append(output, html, end - html);
+}
+
+/* Writes the gutter span for the current line, or only notes where it goes when gutters are deferred */
+static void output_line_number(s2html_emitter_t *emitter)
+{
+	gutter_marks_t *marks = emitter->deferred_gutters;
+	size_t *grown, capacity;
+
+	if (marks == NULL)
+	{
+		append_line_number(emitter->output, emitter->current_line_number, emitter->options);
+		return;
+	}
+	if (marks->count == marks->capacity)
+	{
+		capacity = marks->capacity ? marks->capacity * 2 : 1024;
+		if (NULL == (grown = realloc(marks->offsets, capacity * sizeof(*grown))))
+		{
+			marks->failed = 1;
+			return;
+		}
+		marks->offsets = grown;
+		marks->capacity = capacity;
+	}
+	marks->offsets[marks->count++] = emitter->output->length;
+}
+
+/* Lets the owner end the page before the first byte of emitter->next_page_line; the span open in the output (its
+   style bit, 0 for none) is closed at the end of the page and opened again on the next */
+static void break_page(s2html_emitter_t *emitter, unsigned int open_style_bit)
+{
+	const span_markup_t *markup;
+	int style;
+
+	if (open_style_bit)
+		output_append(emitter->output, OUTPUT_LITERAL("</span>"));
+	emitter->page_break(emitter);
+	if (open_style_bit)
+	{
+		for (style = 0; STYLE_BIT(style) != open_style_bit; style++)
+			;
+		markup = &style_markup[emitter->compact][style];
+		output_append(emitter->output, markup->prefix, markup->prefix_length);
+		emitter->used_classes |= open_style_bit;
+	}
 }
 
-/* Helper function to output content with line number handling */
-static void output_with_line_numbers(FILE* output_file, const char* content)
+/* Helper function to output content with line number handling; clean runs between special bytes are copied in bulk.
+   open_style_bit is the span the content is written in, 0 for none. */
+static void output_with_line_numbers(s2html_emitter_t *emitter, const char *content, size_t length, unsigned int open_style_bit)
 {
-	int i;
-	for (i = 0; content[i] != '\0'; i++)
+	size_t i = 0, run_length;
+
+	while (i < length)
 	{
 		/* Print line number at start of line */
-		if (line_number_enabled && line_start)
+		if (emitter->line_start && (emitter->line_number_enabled || emitter->next_page_line))
 		{
-			fprintf(output_file, "<span class=\"line-number\">%4d</span> ", current_line_number);
-			line_start = 0;
+			if (emitter->next_page_line && emitter->current_line_number >= emitter->next_page_line)
+				break_page(emitter, open_style_bit);
+			if (emitter->line_number_enabled)
+				output_line_number(emitter);
+			emitter->line_start = 0;
 		}
-		
+
+		/* Copy everything up to the next byte that needs attention */
+		run_length = emitter->escape_scan(content + i, length - i);
+		output_append(emitter->output, content + i, run_length);
+		i += run_length;
+		if (i == length)
+			break;
+
 		/* Output character with HTML escaping */
-		if (content[i] == '<')
-			fprintf(output_file, "&lt;");
-		else if (content[i] == '>')
-			fprintf(output_file, "&gt;");
-		else if (content[i] == '&')
-			fprintf(output_file, "&amp;");
-		else
-			fputc(content[i], output_file);
-		
-		/* Handle newline */
-		if (content[i] == '\n')
+		switch (content[i++])
 		{
-			current_line_number++;
-			line_start = 1;
+		case '<':
+			STATS_ADD(emitter->stats, bytes_escaped, 1);
+			output_append(emitter->output, OUTPUT_LITERAL("&lt;"));
+			break;
+		case '>':
+			STATS_ADD(emitter->stats, bytes_escaped, 1);
+			output_append(emitter->output, OUTPUT_LITERAL("&gt;"));
+			break;
+		case '&':
+			STATS_ADD(emitter->stats, bytes_escaped, 1);
+			output_append(emitter->output, OUTPUT_LITERAL("&amp;"));
+			break;
+		default: /* Handle newline */
+			output_append_char(emitter->output, '\n');
+			emitter->current_line_number++;
+			emitter->line_start = 1;
+			if (emitter->line_index)
+				add_line_position(emitter->line_index, emitter->output->bytes_written + emitter->output->length,
+								  emitter->source->discarded + (size_t)(content + i - emitter->source->data));
+			break;
 		}
 	}
 }
 
-/* Token to HTML conversion function */
-void convert_token_to_html(FILE* output_file, parser_token_t *token_data, int enable_line_numbers)
+/* Compact mode keeps a span open over blank text: the whitespace between two tokens of one class looks the same
+   inside the span as outside it */
+static inline int is_blank_text(const char *content, size_t size)
 {
-	line_number_enabled = enable_line_numbers;
-	
+	size_t i;
+
+	for (i = 0; i < size; i++)
+		if (content[i] != ' ' && content[i] != '\t' && content[i] != '\n' && content[i] != '\r')
+			return 0;
+	return 1;
+}
+
+/* Writes one token as a span; shared by the token by token and the token table paths */
+static inline void emit_token(s2html_emitter_t *emitter, token_type_t type, int attribute, const char *content, size_t size)
+{
+	const span_markup_t *markup;
+	int style, system_header = 0;
+
 #ifdef DEBUG
-	printf("%s", token_data->content);
+	printf("%.*s", (int)size, content);
 #endif
 	
-	switch(token_data->type)
+	switch(type)
 	{
-		case TOKEN_PREPROCESSOR_DIRECTIVE:
-			fprintf(output_file,"<span class=\"preprocess_dir\">");
-			output_with_line_numbers(output_file, token_data->content);
-			fprintf(output_file,"</span>");
+		case TOKEN_HEADER_FILE:
+			/* Handle user-defined vs system headers differently */
+			style = STYLE_HEADER_FILE;
+			system_header = attribute != USER_DEFINED_HEADER;
+			break;
+		case TOKEN_RESERVE_KEYWORD:
+			style = attribute == DATATYPE_KEYWORD ? STYLE_RESERVED_KEY1 : STYLE_RESERVED_KEY2;
 			break;
+		case TOKEN_PREPROCESSOR_DIRECTIVE:
 		case TOKEN_MULTI_LINE_COMMENT:
 		case TOKEN_SINGLE_LINE_COMMENT:
-			fprintf(output_file,"<span class=\"comment\">");
-			output_with_line_numbers(output_file, token_data->content);
-			fprintf(output_file,"</span>");
-			break;
 		case TOKEN_STRING_LITERAL:
-			fprintf(output_file,"<span class=\"string\">");
-			output_with_line_numbers(output_file, token_data->content);
-			fprintf(output_file,"</span>");
-			break;
-		case TOKEN_HEADER_FILE:
-			/* Handle user-defined vs system headers differently */
-			if(token_data->attribute == USER_DEFINED_HEADER)
-			{
-				fprintf(output_file,"<span class=\"header_file\">");
-				output_with_line_numbers(output_file, token_data->content);
-				fprintf(output_file,"</span>");
-			}
-			else
-			{
-				fprintf(output_file,"<span class=\"header_file\">&lt;");
-				output_with_line_numbers(output_file, token_data->content);
-				fprintf(output_file,"&gt;</span>");
-			}
-			break;
 		case TOKEN_REGULAR_TEXT:
-		case TOKEN_END_OF_FILE :
-			output_with_line_numbers(output_file, token_data->content);
-			break;
+		case TOKEN_END_OF_FILE:
 		case TOKEN_NUMERIC_CONSTANT:
-			fprintf(output_file,"<span class=\"numeric_constant\">");
-			output_with_line_numbers(output_file, token_data->content);
-			fprintf(output_file,"</span>");
-			break;
-		case TOKEN_RESERVE_KEYWORD:
-			if(token_data->attribute == DATATYPE_KEYWORD)
-			{
-				fprintf(output_file,"<span class=\"reserved_key1\">");
-				output_with_line_numbers(output_file, token_data->content);
-				fprintf(output_file,"</span>");
-			}
-			else
-			{
-				fprintf(output_file,"<span class=\"reserved_key2\">");
-				output_with_line_numbers(output_file, token_data->content);
-				fprintf(output_file,"</span>");
-			}
-			break;
 		case TOKEN_ASCII_CHAR:
-			fprintf(output_file,"<span class=\"ascii_char\">");
-			output_with_line_numbers(output_file, token_data->content);
-			fprintf(output_file,"</span>");
-			break;
 		case TOKEN_FORMAT_SPECIFIER:
-			fprintf(output_file,"<span class=\"format_specifier\">");
-			output_with_line_numbers(output_file, token_data->content);
-			fprintf(output_file,"</span>");
-			break;
 		case TOKEN_OPERATORS:
-			fprintf(output_file,"<span class=\"operators\">");
-			output_with_line_numbers(output_file, token_data->content);
-			fprintf(output_file,"</span>");
-			break;
 		case TOKEN_SYMBOL:
-			fprintf(output_file,"<span class=\"symbols\">");
-			output_with_line_numbers(output_file, token_data->content);
-			fprintf(output_file,"</span>");
+			style = token_style[type];
 			break;
 		default :
+#ifdef DEBUG
 			printf("ERROR: Unknown token type encountered\n");
-			break;
+#endif
+			return;
+	}
+
+	STATS_ADD(emitter->stats, tokens[type], 1);
+	markup = &style_markup[emitter->compact][style];
+	emitter->used_classes |= markup->style_bit;
+	if (!emitter->compact)
+	{
+		output_append(emitter->output, markup->prefix, markup->prefix_length);
+	}
+	else if (markup->style_bit != emitter->open_style_bit && !(style == STYLE_NONE && type != TOKEN_END_OF_FILE && is_blank_text(content, size)))
+	{
+		/* Compact: the open span continues over tokens of its class, only a different class or the end closes it */
+		if (emitter->open_style_bit)
+			output_append(emitter->output, OUTPUT_LITERAL("</span>"));
+		output_append(emitter->output, markup->prefix, markup->prefix_length);
+		emitter->open_style_bit = markup->style_bit;
 	}
-}
\ No newline at end of file
+	if (system_header)
+		output_append(emitter->output, OUTPUT_LITERAL("&lt;"));
+	output_with_line_numbers(emitter, content, size, emitter->compact ? emitter->open_style_bit : markup->style_bit);
+	if (system_header)
+		output_append(emitter->output, OUTPUT_LITERAL("&gt;"));
+	if (!emitter->compact)
+		output_append(emitter->output, markup->suffix, markup->suffix_length);
+}
+
+/* Token to HTML conversion function */
+void convert_token_to_html(s2html_emitter_t *emitter, parser_token_t *token_data)
+{
+	emit_token(emitter, token_data->type, token_data->attribute, token_data->content, token_data->size);
+}
+
+/* Emit pass over a token table filled by lex_source_to_table from the bytes at source_data */
+void emit_token_table(s2html_emitter_t *emitter, const token_table_t *table, const char *source_data)
+{
+	size_t i;
+
+	for (i = 0; i < table->count; i++)
+		emit_token(emitter, table->types[i], table->attributes[i], source_data + table->offsets[i], table->lengths[i]);
+}
+
+/* One whole conversion, counted into stats and line starts stored in line_index when those are not NULL */
+static void convert_source(source_buffer_t *source, output_buffer_t *output, int options, struct s2html_stats *stats, line_index_t *line_index)
+{
+	s2html_lexer_t lexer;
+	s2html_emitter_t emitter;
+	parser_token_t *parsed_token;
+	output_buffer_t body;
+	int buffer_body;
+#ifdef S2HTML_STATS
+	unsigned long long started = stats ? stats_now_nanoseconds() : 0;
+	size_t output_start = output->bytes_written + output->length;
+#else
+	(void)stats;
+#endif
+
+	init_lexer(&lexer, source);
+	lexer.table_driven = (options & CONVERT_DFA_LEXER) != 0;
+	lexer.byte_at_a_time = (options & CONVERT_BYTE_AT_A_TIME) != 0;
+	init_emitter(&emitter, output, options);
+#ifdef S2HTML_STATS
+	lexer.stats = stats;
+	emitter.stats = stats;
+#endif
+
+	/* An embedded theme depends on the classes used, so the body is kept in memory until the header is written; an
+	   output cut from an arena has the body cut from the same arena. A full theme covers every class up front */
+	buffer_body = emitter.embed_css && !(options & CONVERT_FULL_THEME);
+	if (buffer_body)
+	{
+		if (output->arena ? !open_arena_output_buffer(&body, NULL, output->arena) : !open_memory_output_buffer(&body))
+		{
+			output->error = 1;
+			return;
+		}
+		emitter.output = &body;
+	}
+	else
+	{
+		if (emitter.embed_css)
+			emitter.used_classes = (STYLE_BIT(STYLE_CLASS_COUNT) - 1) & ~STYLE_BIT(STYLE_LINE_NUMBER);
+		generate_html_header(&emitter, HTML_DOCUMENT_START);
+	}
+	if (line_index)
+	{
+		emitter.line_index = line_index;
+		emitter.source = source;
+		add_line_position(line_index, emitter.output->bytes_written + emitter.output->length, 0);
+	}
+	do
+	{
+		parsed_token = extract_next_token(&lexer);
+		convert_token_to_html(&emitter, parsed_token);
+	} while (parsed_token->type != TOKEN_END_OF_FILE);
+	if (source->error) /* the lexer saw the end of input early */
+		output->error = 1;
+	if (line_index)
+		end_line_index(line_index, emitter.output->bytes_written + emitter.output->length, source->discarded + source->length);
+	if (buffer_body)
+	{
+		emitter.output = output;
+		generate_html_header(&emitter, HTML_DOCUMENT_START);
+		if (line_index) /* the body was indexed from its own first byte */
+			line_index->html_base = output->bytes_written + output->length;
+		output_append(output, body.data, body.length);
+		if (body.error)
+			output->error = 1;
+		close_output_buffer(&body);
+	}
+	generate_html_footer(&emitter, HTML_DOCUMENT_END);
+
+#ifdef S2HTML_STATS
+	if (stats)
+	{
+		stats->output_bytes += output->bytes_written + output->length - output_start;
+		stats->source_bytes += source->discarded + source->length;
+		stats->total_nanoseconds += stats_now_nanoseconds() - started;
+	}
+#endif
+}
+
+/* Runs one whole conversion: document header, every token of source, document footer; options are CONVERT_* flags */
+void convert_source_to_html(source_buffer_t *source, output_buffer_t *output, int options)
+{
+	convert_source_to_html_counted(source, output, options, NULL);
+}
+
+/* Same conversion, counting into stats when it is not NULL (S2HTML_STATS builds only, other builds ignore it) */
+void convert_source_to_html_counted(source_buffer_t *source, output_buffer_t *output, int options, struct s2html_stats *stats)
+{
+	convert_source(source, output, options, stats, NULL);
+}
+
+/* Same conversion, storing where every line starts in line_index; output must start at the beginning of the file */
+void convert_source_to_html_indexed(source_buffer_t *source, output_buffer_t *output, int options, struct s2html_line_index *line_index)
+{
+	convert_source(source, output, options, NULL, line_index);
+}
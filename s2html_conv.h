@@ -1,6 +1,9 @@
 #ifndef S2HTML_CONV_H
 #define S2HTML_CONV_H
 
+#include "s2html_output.h"
+#include "s2html_escape.h"
+
 /* HTML generation mode constants */
 
 #define HTML_DOCUMENT_START 1
@@ -10,10 +13,60 @@
 #define LINE_NUMBERING_ENABLED 1
 #define LINE_NUMBERING_DISABLED 0
 
+/* Conversion options, or'ed into the options argument; the line number bit is LINE_NUMBERING_ENABLED, so 0/1 still work */
+#define CONVERT_LINE_NUMBERS	LINE_NUMBERING_ENABLED	/* -n: gutter span at each line start */
+#define CONVERT_EMBED_CSS		0x02	/* --embed-css: inline the theme rules the document uses instead of linking styles.css */
+#define CONVERT_COMPACT			0x04	/* --compact: short class names, one span per run of same class tokens */
+#define CONVERT_LINE_ANCHORS	0x08	/* gutter spans carry id="L<line>", so links can point at a line */
+#define CONVERT_DFA_LEXER		0x10	/* --lexer=dfa: tokens come from the table generated from s2html_lexer.def, same HTML */
+#define CONVERT_SCALAR_ESCAPE	0x20	/* escape_scan_scalar instead of the SIMD kernel, same HTML; for the differential harness */
+#define CONVERT_BYTE_AT_A_TIME	0x40	/* no memchr or run scans in the lexer, same HTML; for the differential harness */
+#define CONVERT_FULL_THEME		0x80	/* with CONVERT_EMBED_CSS: inline every theme rule, so the body streams instead of waiting in memory */
+#define CONVERT_ENGINE_FLAGS	(CONVERT_DFA_LEXER | CONVERT_SCALAR_ESCAPE | CONVERT_BYTE_AT_A_TIME)	/* how, not what, is converted */
+
+/* Output offsets where gutter spans belong, for HTML produced before its line numbers are known */
+typedef struct
+{
+	size_t *offsets;			// ascending
+	size_t count;
+	size_t capacity;
+	int failed;					// out of memory, offsets are incomplete
+}gutter_marks_t;
+
+/* Emitter context: HTML writing state for one document */
+typedef struct s2html_emitter
+{
+	output_buffer_t *output;	// destination of the generated HTML
+	int current_line_number;	// line the next content byte belongs to
+	int line_number_enabled;	// non-zero => write a gutter span at each line start
+	int line_start;				// flag to track if we're at the start of a line
+	gutter_marks_t *deferred_gutters;	// non-NULL => record where gutters go instead of writing them
+	int embed_css;				// non-zero => the header inlines the rules of used_classes
+	unsigned int used_classes;	// bit per style class a span was written with
+	int compact;				// non-zero => short class names and merged spans
+	escape_scan_fn escape_scan;	// finds clean runs: the CPU's kernel, or escape_scan_scalar with CONVERT_SCALAR_ESCAPE
+	unsigned int open_style_bit;	// compact: style bit of the span still open at the end of the output, 0 if none
+	int options;				// CONVERT_* flags the emitter was set up with
+	int next_page_line;			// > 0 => call page_break before the first byte of this line is written
+	void (*page_break)(struct s2html_emitter *emitter);	// completes the page in output and starts the next one
+	void *page_context;			// owner data for page_break
+	struct s2html_line_index *line_index;	// NULL => line starts are not recorded
+	const source_buffer_t *source;	// line_index only: the buffer token content points into
+	struct s2html_stats *stats;	// NULL => not counted; only S2HTML_STATS builds count anything
+}s2html_emitter_t;
+
 /********** function prototypes **********/
 
-void generate_html_header(FILE *output_file, int mode); /* mode => controls HTML tag generation behavior */
-void generate_html_footer(FILE *output_file, int mode); /* mode => controls HTML tag generation behavior */
-void convert_token_to_html(FILE *output_file, parser_token_t *token_data, int enable_line_numbers);
+void init_emitter(s2html_emitter_t *emitter, output_buffer_t *output, int options);
+void generate_html_header(s2html_emitter_t *emitter, int mode); /* mode => controls HTML tag generation behavior */
+void generate_html_footer(s2html_emitter_t *emitter, int mode); /* mode => controls HTML tag generation behavior */
+void append_line_number(output_buffer_t *output, int line_number, int options);
+unsigned int collect_style_classes(const char *html, size_t length, int compact);
+void append_renumbered_html(output_buffer_t *output, const char *html, size_t length, int delta);
+void convert_token_to_html(s2html_emitter_t *emitter, parser_token_t *token_data);
+void emit_token_table(s2html_emitter_t *emitter, const token_table_t *table, const char *source_data);
+void convert_source_to_html(source_buffer_t *source, output_buffer_t *output, int options);
+void convert_source_to_html_counted(source_buffer_t *source, output_buffer_t *output, int options, struct s2html_stats *stats);
+void convert_source_to_html_indexed(source_buffer_t *source, output_buffer_t *output, int options, struct s2html_line_index *line_index);
 
 #endif
\ No newline at end of file
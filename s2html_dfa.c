@@ -0,0 +1,73 @@
+#include "s2html_event.h"
+
+/* Transition table and byte classes, generated from s2html_lexer.def */
+#include "s2html_dfa.h"
+
+/********** Helper function implementations **********/
+
+/* Takes the word just emitted through the keyword table, as the KEYWORD state handler does */
+static void classify_word(parser_token_t *token)
+{
+	int keyword_classification = classify_keyword(token->content, token->size);
+
+	if (keyword_classification == DATATYPE_KEYWORD || keyword_classification == CONTROL_KEYWORD)
+		token->attribute = keyword_classification;
+	else
+		token->type = TOKEN_REGULAR_TEXT;
+}
+
+/* ********************************************************************************************************************** */
+/* ********************************************************************************************************************** */
+
+/* Table driven extract_next_token: one byte class lookup and one transition lookup per byte, no call until the token
+   ends or the buffered bytes run out. Returns the same tokens as the state handlers */
+parser_token_t *extract_next_token_dfa(s2html_lexer_t *lexer)
+{
+	source_buffer_t *source = lexer->source;
+	parser_token_t *token = &lexer->current_token;
+	const unsigned char *data = (const unsigned char *)source->data;
+	size_t position = source->position, length = source->length, start = position, end;
+	unsigned int row = lexer->dfa_state, entry = 0, action;
+
+	for (;;)
+	{
+		/* An entry that only takes the byte is the next row, anything larger ends the token */
+		while (position < length && (entry = dfa_transitions[row + dfa_byte_class[data[position++]]]) <= DFA_ROW_MASK)
+			row = entry;
+		if (entry > DFA_ROW_MASK)
+			break;
+
+		/* Out of buffered bytes: a stream window slides (keeping the token from start on) and the byte is read again,
+		   otherwise this is the end of input, read like a byte */
+		source->position = position;
+		source->pinned = start;
+		if (source_refill_next(source) == SOURCE_EOF)
+		{
+			entry = dfa_transitions[row + DFA_CLASS_END];
+			data = (const unsigned char *)source->data;
+			position = source->position;
+			start = source->pinned;
+			break;
+		}
+		data = (const unsigned char *)source->data;
+		position = source->position - 1;
+		length = source->length;
+		start = source->pinned;
+	}
+
+	action = (entry >> DFA_ACTION_SHIFT) & DFA_ACTION_MASK;
+	end = position - dfa_excluded[action];
+	token->content = end > start ? (const char *)data + start : "";
+	token->size = end - start;
+	token->type = (entry >> DFA_TOKEN_SHIFT) & DFA_TOKEN_MASK;
+	if (entry & DFA_USER_HEADER)
+		token->attribute = USER_DEFINED_HEADER;
+	if (entry & DFA_CLASSIFY)
+		classify_word(token);
+	source->position = position - dfa_reread[action];
+	source->pinned = SOURCE_UNPINNED;
+	lexer->dfa_state = entry & DFA_ROW_MASK;
+	return token;
+}
+
+/**** End of file ****/
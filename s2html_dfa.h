@@ -0,0 +1,200 @@
+/* Generated by s2html_dfagen from s2html_lexer.def - do not edit */
+
+#ifndef S2HTML_DFA_H
+#define S2HTML_DFA_H
+
+#define DFA_STATE_COUNT			38		/* specification states, each without and with the space flag */
+#define DFA_CLASS_COUNT			22
+#define DFA_CLASS_END			21		/* column read at the end of input */
+#define DFA_START_STATE			0		/* row offset, as every state in an entry */
+
+/* Entry: row of the next state, then action, token type emitted, attribute and keyword flags. An entry at most
+   DFA_ROW_MASK only takes the byte, and is the next row itself */
+#define DFA_ROW_MASK			0xffff
+#define DFA_ACTION_SHIFT		16
+#define DFA_ACTION_MASK			0x7
+#define DFA_TOKEN_SHIFT			19
+#define DFA_TOKEN_MASK			0xf
+#define DFA_USER_HEADER			0x800000u	/* the token's attribute becomes USER_DEFINED_HEADER */
+#define DFA_CLASSIFY			0x1000000u	/* the token goes through the keyword table */
+
+/* Per action: bytes read that the token leaves out, and bytes read again for the next token */
+static const unsigned char dfa_excluded[6] = {0, 0, 1, 1, 2, 1};
+static const unsigned char dfa_reread[6] = {0, 0, 1, 0, 2, 0};
+
+static const unsigned char dfa_byte_class[256] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	3, 4, 5, 6, 0, 7, 4, 8, 9, 10, 11, 4, 12, 4, 13, 14,
+	15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 9, 1, 16, 4, 17, 0,
+	0, 18, 18, 18, 18, 18, 18, 18, 18, 18, 18, 18, 18, 18, 18, 18,
+	18, 18, 18, 18, 18, 18, 18, 18, 18, 18, 18, 9, 19, 10, 4, 20,
+	0, 18, 18, 18, 18, 18, 18, 18, 18, 18, 18, 18, 18, 18, 18, 18,
+	18, 18, 18, 18, 18, 18, 18, 18, 18, 18, 18, 9, 4, 10, 4, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+static const unsigned int dfa_transitions[DFA_STATE_COUNT * DFA_CLASS_COUNT] = {
+	/* IDLE */
+	0x000002c, 0x000002c, 0x000002c, 0x000002c, 0x000023c, 0x0000134, 0x00002c0, 0x000023c,
+	0x00001b8, 0x0000268, 0x0000268, 0x000023c, 0x000023c, 0x000002c, 0x0000058, 0x0000210,
+	0x000023c, 0x000023c, 0x0000294, 0x000002c, 0x0000294, 0x06d0000,
+	/* IDLE, spaced */
+	0x0000042, 0x0000042, 0x0000042, 0x0000042, 0x0000252, 0x000014a, 0x00002d6, 0x0000252,
+	0x00001ce, 0x000027e, 0x000027e, 0x0000252, 0x0000252, 0x0000042, 0x000006e, 0x0000226,
+	0x0000252, 0x0000252, 0x00002aa, 0x0000042, 0x00002aa, 0x06d0016,
+	/* TEXT */
+	0x000002c, 0x000002c, 0x000002c, 0x000002c, 0x032023c, 0x0320000, 0x0320000, 0x032023c,
+	0x0320000, 0x0320268, 0x0320268, 0x032023c, 0x032023c, 0x000002c, 0x0000084, 0x0320000,
+	0x032023c, 0x032023c, 0x0320000, 0x000002c, 0x0320000, 0x06d002c,
+	/* TEXT, spaced */
+	0x0000042, 0x0000042, 0x0000042, 0x0000042, 0x0320252, 0x0320016, 0x0320016, 0x0320252,
+	0x0320016, 0x032027e, 0x032027e, 0x0320252, 0x0320252, 0x0000042, 0x000009a, 0x0320016,
+	0x0320252, 0x0320252, 0x0320016, 0x0000042, 0x0320016, 0x06d0042,
+	/* SLASH */
+	0x000002c, 0x000002c, 0x000002c, 0x000002c, 0x000002c, 0x000002c, 0x000002c, 0x000002c,
+	0x000002c, 0x000002c, 0x000002c, 0x00000dc, 0x000002c, 0x000002c, 0x0000108, 0x000002c,
+	0x000002c, 0x000002c, 0x000002c, 0x000002c, 0x000002c, 0x06d0058,
+	/* SLASH, spaced */
+	0x0000042, 0x0000042, 0x0000042, 0x0000042, 0x0000042, 0x0000042, 0x0000042, 0x0000042,
+	0x0000042, 0x0000042, 0x0000042, 0x00000f2, 0x0000042, 0x0000042, 0x000011e, 0x0000042,
+	0x0000042, 0x0000042, 0x0000042, 0x0000042, 0x0000042, 0x06d006e,
+	/* TEXT_SLASH */
+	0x000002c, 0x000002c, 0x000002c, 0x000002c, 0x000002c, 0x000002c, 0x000002c, 0x000002c,
+	0x000002c, 0x000002c, 0x000002c, 0x0340000, 0x000002c, 0x000002c, 0x0340000, 0x000002c,
+	0x000002c, 0x000002c, 0x000002c, 0x000002c, 0x000002c, 0x06d0084,
+	/* TEXT_SLASH, spaced */
+	0x0000042, 0x0000042, 0x0000042, 0x0000042, 0x0000042, 0x0000042, 0x0000042, 0x0000042,
+	0x0000042, 0x0000042, 0x0000042, 0x0340016, 0x0000042, 0x0000042, 0x0340016, 0x0000042,
+	0x0000042, 0x0000042, 0x0000042, 0x0000042, 0x0000042, 0x06d009a,
+	/* BLOCK_COMMENT */
+	0x00000b0, 0x00000b0, 0x00000b0, 0x00000b0, 0x00000b0, 0x00000b0, 0x00000b0, 0x00000b0,
+	0x00000b0, 0x00000b0, 0x00000b0, 0x00000dc, 0x00000b0, 0x00000b0, 0x00000b0, 0x00000b0,
+	0x00000b0, 0x00000b0, 0x00000b0, 0x00000b0, 0x00000b0, 0x06d00b0,
+	/* BLOCK_COMMENT, spaced */
+	0x00000c6, 0x00000c6, 0x00000c6, 0x00000c6, 0x00000c6, 0x00000c6, 0x00000c6, 0x00000c6,
+	0x00000c6, 0x00000c6, 0x00000c6, 0x00000f2, 0x00000c6, 0x00000c6, 0x00000c6, 0x00000c6,
+	0x00000c6, 0x00000c6, 0x00000c6, 0x00000c6, 0x00000c6, 0x06d00c6,
+	/* BLOCK_COMMENT_STAR */
+	0x00000b0, 0x00000b0, 0x00000b0, 0x00000b0, 0x00000b0, 0x00000b0, 0x00000b0, 0x00000b0,
+	0x00000b0, 0x00000b0, 0x00000b0, 0x00000dc, 0x00000b0, 0x00000b0, 0x0410000, 0x00000b0,
+	0x00000b0, 0x00000b0, 0x00000b0, 0x00000b0, 0x00000b0, 0x06d00dc,
+	/* BLOCK_COMMENT_STAR, spaced */
+	0x00000c6, 0x00000c6, 0x00000c6, 0x00000c6, 0x00000c6, 0x00000c6, 0x00000c6, 0x00000c6,
+	0x00000c6, 0x00000c6, 0x00000c6, 0x00000f2, 0x00000c6, 0x00000c6, 0x0410016, 0x00000c6,
+	0x00000c6, 0x00000c6, 0x00000c6, 0x00000c6, 0x00000c6, 0x06d00f2,
+	/* LINE_COMMENT */
+	0x0000108, 0x0000108, 0x0390000, 0x0000108, 0x0000108, 0x0000108, 0x0000108, 0x0000108,
+	0x0000108, 0x0000108, 0x0000108, 0x0000108, 0x0000108, 0x0000108, 0x0000108, 0x0000108,
+	0x0000108, 0x0000108, 0x0000108, 0x0000108, 0x0000108, 0x06d0108,
+	/* LINE_COMMENT, spaced */
+	0x000011e, 0x000011e, 0x0390016, 0x000011e, 0x000011e, 0x000011e, 0x000011e, 0x000011e,
+	0x000011e, 0x000011e, 0x000011e, 0x000011e, 0x000011e, 0x000011e, 0x000011e, 0x000011e,
+	0x000011e, 0x000011e, 0x000011e, 0x000011e, 0x000011e, 0x06d011e,
+	/* STRING */
+	0x0000134, 0x0000134, 0x0000134, 0x0000134, 0x0000134, 0x0210000, 0x0000134, 0x0220160,
+	0x0000134, 0x0000134, 0x0000134, 0x0000134, 0x0000134, 0x0000134, 0x0000134, 0x0000134,
+	0x0000134, 0x0000134, 0x0000134, 0x0000134, 0x0000134, 0x06d0134,
+	/* STRING, spaced */
+	0x000014a, 0x000014a, 0x000014a, 0x000014a, 0x000014a, 0x0210016, 0x000014a, 0x0220176,
+	0x000014a, 0x000014a, 0x000014a, 0x000014a, 0x000014a, 0x000014a, 0x000014a, 0x000014a,
+	0x000014a, 0x000014a, 0x000014a, 0x000014a, 0x000014a, 0x06d014a,
+	/* FORMAT */
+	0x0000160, 0x0000160, 0x0000160, 0x0520134, 0x0000160, 0x0520134, 0x0000160, 0x0000160,
+	0x0000160, 0x0000160, 0x0000160, 0x0000160, 0x0000160, 0x000018c, 0x0000160, 0x0000160,
+	0x0000160, 0x0000160, 0x0000160, 0x0520134, 0x0000160, 0x06d0160,
+	/* FORMAT, spaced */
+	0x0000176, 0x0000176, 0x0000176, 0x052014a, 0x0000176, 0x052014a, 0x0000176, 0x0000176,
+	0x0000176, 0x0000176, 0x0000176, 0x0000176, 0x0000176, 0x00001a2, 0x0000176, 0x0000176,
+	0x0000176, 0x0000176, 0x0000176, 0x052014a, 0x0000176, 0x06d0176,
+	/* FORMAT_DOT */
+	0x0540134, 0x0540134, 0x0540134, 0x0540134, 0x0540134, 0x0540134, 0x0540134, 0x0540134,
+	0x0540134, 0x0540134, 0x0540134, 0x0540134, 0x0540134, 0x0540134, 0x0540134, 0x0000160,
+	0x0540134, 0x0540134, 0x0540134, 0x0540134, 0x0540134, 0x0540134,
+	/* FORMAT_DOT, spaced */
+	0x054014a, 0x054014a, 0x054014a, 0x054014a, 0x054014a, 0x054014a, 0x054014a, 0x054014a,
+	0x054014a, 0x054014a, 0x054014a, 0x054014a, 0x054014a, 0x054014a, 0x054014a, 0x0000176,
+	0x054014a, 0x054014a, 0x054014a, 0x054014a, 0x054014a, 0x054014a,
+	/* ASCII */
+	0x00001b8, 0x00001b8, 0x00001b8, 0x00001b8, 0x00001b8, 0x00001b8, 0x00001b8, 0x00001b8,
+	0x00001e4, 0x00001b8, 0x00001b8, 0x00001b8, 0x00001b8, 0x00001b8, 0x00001b8, 0x00001b8,
+	0x00001b8, 0x00001b8, 0x00001b8, 0x00001b8, 0x00001b8, 0x06d01b8,
+	/* ASCII, spaced */
+	0x00001ce, 0x00001ce, 0x00001ce, 0x00001ce, 0x00001ce, 0x00001ce, 0x00001ce, 0x00001ce,
+	0x00001fa, 0x00001ce, 0x00001ce, 0x00001ce, 0x00001ce, 0x00001ce, 0x00001ce, 0x00001ce,
+	0x00001ce, 0x00001ce, 0x00001ce, 0x00001ce, 0x00001ce, 0x06d01ce,
+	/* ASCII_QUOTE */
+	0x04a0000, 0x04a0000, 0x04a0000, 0x04a0000, 0x04a0000, 0x04a0000, 0x04a0000, 0x04a0000,
+	0x0490000, 0x04a0000, 0x04a0000, 0x04a0000, 0x04a0000, 0x04a0000, 0x04a0000, 0x04a0000,
+	0x04a0000, 0x04a0000, 0x04a0000, 0x04a0000, 0x04a0000, 0x04a0000,
+	/* ASCII_QUOTE, spaced */
+	0x04a0016, 0x04a0016, 0x04a0016, 0x04a0016, 0x04a0016, 0x04a0016, 0x04a0016, 0x04a0016,
+	0x0490016, 0x04a0016, 0x04a0016, 0x04a0016, 0x04a0016, 0x04a0016, 0x04a0016, 0x04a0016,
+	0x04a0016, 0x04a0016, 0x04a0016, 0x04a0016, 0x04a0016, 0x04a0016,
+	/* NUMBER */
+	0x0000210, 0x01a0000, 0x01a0000, 0x01a0000, 0x0000210, 0x0000210, 0x0000210, 0x0000210,
+	0x0000210, 0x0000210, 0x01a0000, 0x0000210, 0x01a0000, 0x0000210, 0x0000210, 0x0000210,
+	0x0000210, 0x0000210, 0x0000210, 0x0000210, 0x0000210, 0x06d0210,
+	/* NUMBER, spaced */
+	0x0000226, 0x01a0016, 0x01a0016, 0x01a0016, 0x0000226, 0x0000226, 0x0000226, 0x0000226,
+	0x0000226, 0x0000226, 0x01a0016, 0x0000226, 0x01a0016, 0x0000226, 0x0000226, 0x0000226,
+	0x0000226, 0x0000226, 0x0000226, 0x0000226, 0x0000226, 0x06d0226,
+	/* OPERATORS */
+	0x05a0000, 0x05a0000, 0x05a0000, 0x05a0000, 0x000023c, 0x05a0000, 0x05a0000, 0x000023c,
+	0x05a0000, 0x05a0000, 0x05a0000, 0x000023c, 0x000023c, 0x05a0000, 0x000023c, 0x05a0000,
+	0x000023c, 0x000023c, 0x05a0000, 0x05a0000, 0x05a0000, 0x06d023c,
+	/* OPERATORS, spaced */
+	0x05a0016, 0x05a0016, 0x05a0016, 0x05a0016, 0x0000252, 0x05a0016, 0x05a0016, 0x0000252,
+	0x05a0016, 0x05a0016, 0x05a0016, 0x0000252, 0x0000252, 0x05a0016, 0x0000252, 0x05a0016,
+	0x0000252, 0x0000252, 0x05a0016, 0x05a0016, 0x05a0016, 0x06d0252,
+	/* SYMBOLS */
+	0x0620000, 0x0620000, 0x0620000, 0x0620000, 0x0620000, 0x0620000, 0x0620000, 0x0620000,
+	0x0620000, 0x0000268, 0x0000268, 0x0620000, 0x0620000, 0x0620000, 0x0620000, 0x0620000,
+	0x0620000, 0x0620000, 0x0620000, 0x0620000, 0x0620000, 0x06d0268,
+	/* SYMBOLS, spaced */
+	0x0620016, 0x0620016, 0x0620016, 0x0620016, 0x0620016, 0x0620016, 0x0620016, 0x0620016,
+	0x0620016, 0x000027e, 0x000027e, 0x0620016, 0x0620016, 0x0620016, 0x0620016, 0x0620016,
+	0x0620016, 0x0620016, 0x0620016, 0x0620016, 0x0620016, 0x06d027e,
+	/* KEYWORD */
+	0x0000294, 0x1120000, 0x1120000, 0x1120000, 0x112023c, 0x0000294, 0x0000294, 0x112023c,
+	0x0000294, 0x1120268, 0x1120268, 0x112023c, 0x112023c, 0x0000294, 0x112023c, 0x1120210,
+	0x112023c, 0x112023c, 0x0000294, 0x0000294, 0x0000294, 0x06d0294,
+	/* KEYWORD, spaced */
+	0x00002aa, 0x1120016, 0x1120016, 0x1120016, 0x1120252, 0x00002aa, 0x00002aa, 0x1120252,
+	0x00002aa, 0x112027e, 0x112027e, 0x1120252, 0x1120252, 0x00002aa, 0x1120252, 0x1120226,
+	0x1120252, 0x1120252, 0x00002aa, 0x00002aa, 0x00002aa, 0x06d02aa,
+	/* DIRECTIVE */
+	0x00002c0, 0x00002c0, 0x08b0000, 0x00002d6, 0x00002c0, 0x08a02ec, 0x00002c0, 0x00002c0,
+	0x00002c0, 0x00002c0, 0x00002c0, 0x00002c0, 0x00002c0, 0x00002c0, 0x00002c0, 0x00002c0,
+	0x00b02ec, 0x00002c0, 0x00002c0, 0x00002c0, 0x00002c0, 0x06d02c0,
+	/* DIRECTIVE, spaced */
+	0x00002d6, 0x00002d6, 0x08b0016, 0x00002d6, 0x00002d6, 0x08a02ec, 0x00002d6, 0x00002d6,
+	0x00002d6, 0x00002d6, 0x00002d6, 0x00002d6, 0x00002d6, 0x00002d6, 0x00002d6, 0x00002d6,
+	0x00b02ec, 0x00002d6, 0x00a0000, 0x00002d6, 0x00002d6, 0x06d02d6,
+	/* HEADER_START */
+	0x0000318, 0x0000318, 0x0000318, 0x0000318, 0x0000318, 0x0000318, 0x0000318, 0x0000318,
+	0x0000318, 0x0000318, 0x0000318, 0x0000318, 0x0000318, 0x0000318, 0x0000318, 0x0000318,
+	0x0000318, 0x02b0000, 0x0000318, 0x0000318, 0x0000318, 0x06d02ec,
+	/* HEADER_START, spaced */
+	0x000032e, 0x000032e, 0x000032e, 0x000032e, 0x000032e, 0x000032e, 0x000032e, 0x000032e,
+	0x000032e, 0x000032e, 0x000032e, 0x000032e, 0x000032e, 0x000032e, 0x000032e, 0x000032e,
+	0x000032e, 0x02b0016, 0x000032e, 0x000032e, 0x000032e, 0x06d0302,
+	/* HEADER */
+	0x0000318, 0x0000318, 0x0000318, 0x0000318, 0x0000318, 0x0a90000, 0x0000318, 0x0000318,
+	0x0000318, 0x0000318, 0x0000318, 0x0000318, 0x0000318, 0x0000318, 0x0000318, 0x0000318,
+	0x0000318, 0x02b0000, 0x0000318, 0x0000318, 0x0000318, 0x06d0318,
+	/* HEADER, spaced */
+	0x000032e, 0x000032e, 0x000032e, 0x000032e, 0x000032e, 0x0a90016, 0x000032e, 0x000032e,
+	0x000032e, 0x000032e, 0x000032e, 0x000032e, 0x000032e, 0x000032e, 0x000032e, 0x000032e,
+	0x000032e, 0x02b0016, 0x000032e, 0x000032e, 0x000032e, 0x06d032e,
+};
+
+#endif
+/**** End of file ****/
@@ -0,0 +1,269 @@
+#include <stdio.h>
+#include <string.h>
+#include "s2html_event.h"
+
+/*
+ * Lexer table generator: reads the token specification in s2html_lexer.def and prints s2html_dfa.h, the transition
+ * table extract_next_token_dfa runs. Bytes every state treats alike share one column (byte class), and every state is
+ * doubled by the directive space flag, so one lookup gives the next state and what to do with the token. A state is
+ * stored as the offset of its row, and an entry that only takes the byte holds nothing else, so the lexing loop
+ * carries an entry over as the next row without decoding it.
+ *
+ *   gcc s2html_dfagen.c -o s2html_dfagen && ./s2html_dfagen > s2html_dfa.h
+ */
+
+/* State flags */
+#define LEXER_CLASSIFY			0x01
+
+/* Rule effects */
+#define RULE_USER_HEADER		0x01
+#define RULE_SPACED				0x02
+#define RULE_UNSPACED			0x04
+#define RULE_IF_SPACED			0x08
+
+/* Table entry layout, printed into the header */
+#define ROW_BITS				16
+#define ROW_MASK				((1u << ROW_BITS) - 1)
+#define ACTION_SHIFT			ROW_BITS
+#define TOKEN_SHIFT				(ACTION_SHIFT + 3)
+#define USER_HEADER_BIT			(1u << (TOKEN_SHIFT + 4))
+#define CLASSIFY_BIT			(USER_HEADER_BIT << 1)
+#define UNDEFINED_ENTRY			(~0u)
+
+#define END_OF_INPUT			256		/* the byte value standing for the end of input */
+
+enum
+{
+	ACTION_TAKE,
+	ACTION_EMIT_WITH,
+	ACTION_EMIT_BEFORE,
+	ACTION_EMIT_DROP,
+	ACTION_EMIT_BEFORE_TWO,
+	ACTION_END,
+	ACTION_COUNT
+};
+
+/* Per action: bytes read that the token leaves out, and bytes read again by the next token */
+static const struct
+{
+	int excluded;
+	int reread;
+}action_list[ACTION_COUNT] = {
+	{ 0, 0 },
+	{ 0, 0 },
+	{ 1, 1 },
+	{ 1, 0 },
+	{ 2, 2 },
+	{ 1, 0 },			/* the end of input read is the excluded byte */
+};
+
+enum
+{
+#define LEXER_SET(name, bytes) SET_##name,
+#define LEXER_STATE(name, token, flags)
+#define LEXER_RULE(state, set, action, next, effects)
+#include "s2html_lexer.def"
+#undef LEXER_SET
+#undef LEXER_STATE
+#undef LEXER_RULE
+	SET_ANY,
+	SET_END,
+	SET_COUNT
+};
+
+enum
+{
+#define LEXER_SET(name, bytes)
+#define LEXER_STATE(name, token, flags) STATE_##name,
+#define LEXER_RULE(state, set, action, next, effects)
+#include "s2html_lexer.def"
+#undef LEXER_SET
+#undef LEXER_STATE
+#undef LEXER_RULE
+	STATE_COUNT
+};
+
+static const char *set_bytes[SET_COUNT] = {
+#define LEXER_SET(name, bytes) bytes,
+#define LEXER_STATE(name, token, flags)
+#define LEXER_RULE(state, set, action, next, effects)
+#include "s2html_lexer.def"
+#undef LEXER_SET
+#undef LEXER_STATE
+#undef LEXER_RULE
+};
+
+static const struct
+{
+	const char *name;
+	token_type_t token;
+	int flags;
+}state_list[STATE_COUNT] = {
+#define LEXER_SET(name, bytes)
+#define LEXER_STATE(name, token, flags) { #name, token, flags },
+#define LEXER_RULE(state, set, action, next, effects)
+#include "s2html_lexer.def"
+#undef LEXER_SET
+#undef LEXER_STATE
+#undef LEXER_RULE
+};
+
+typedef struct
+{
+	int state;
+	int set;
+	int action;
+	int next;
+	int effects;
+}lexer_rule_t;
+
+static const lexer_rule_t rule_list[] = {
+#define LEXER_SET(name, bytes)
+#define LEXER_STATE(name, token, flags)
+#define LEXER_RULE(state, set, action, next, effects) { STATE_##state, SET_##set, ACTION_##action, STATE_##next, effects },
+#include "s2html_lexer.def"
+#undef LEXER_SET
+#undef LEXER_STATE
+#undef LEXER_RULE
+};
+
+#define RULE_COUNT ((int)(sizeof(rule_list) / sizeof(rule_list[0])))
+#define DFA_STATE_COUNT (STATE_COUNT * 2)	/* every state without and with the space flag */
+
+/********** Helper function implementations **********/
+
+/* Non-zero when byte (or END_OF_INPUT) is in set */
+static int set_holds(int set, int byte)
+{
+	const unsigned char *member;
+
+	if (set == SET_ANY)
+		return byte != END_OF_INPUT;
+	if (set == SET_END || byte == END_OF_INPUT)
+		return set == SET_END && byte == END_OF_INPUT;
+	for (member = (const unsigned char *)set_bytes[set]; *member; member++)
+	{
+		if (member[1] == '-' && member[2] != '\0') /* range */
+		{
+			if (byte >= member[0] && byte <= member[2])
+				return 1;
+			member += 2;
+		}
+		else if (byte == member[0])
+			return 1;
+	}
+	return 0;
+}
+
+/* Entry for one state (spaced or not) reading byte, with the next state's index where its row offset goes; returns
+   UNDEFINED_ENTRY when the specification leaves it undefined */
+static unsigned int make_entry(int state, int spaced, int byte)
+{
+	const lexer_rule_t *rule;
+	int i, next_spaced;
+
+	for (i = 0; i < RULE_COUNT; i++)
+	{
+		rule = &rule_list[i];
+		if (rule->state != state || !set_holds(rule->set, byte) || ((rule->effects & RULE_IF_SPACED) && !spaced))
+			continue;
+		next_spaced = (rule->effects & RULE_SPACED) ? 1 : (rule->effects & RULE_UNSPACED) ? 0 : spaced;
+		if (rule->action == ACTION_TAKE)
+			return byte == END_OF_INPUT || (rule->effects & RULE_USER_HEADER) ? UNDEFINED_ENTRY : (unsigned int)(rule->next * 2 + next_spaced);
+		return (rule->next * 2 + next_spaced) | (rule->action << ACTION_SHIFT) | (state_list[state].token << TOKEN_SHIFT) |
+			   ((rule->effects & RULE_USER_HEADER) ? USER_HEADER_BIT : 0) | ((state_list[state].flags & LEXER_CLASSIFY) ? CLASSIFY_BIT : 0);
+	}
+	if (byte == END_OF_INPUT) /* pending bytes become the end of file token */
+		return (state * 2 + spaced) | (ACTION_END << ACTION_SHIFT) | (TOKEN_END_OF_FILE << TOKEN_SHIFT);
+	return UNDEFINED_ENTRY;
+}
+
+int main(void)
+{
+	static unsigned int entries[DFA_STATE_COUNT][END_OF_INPUT + 1];
+	int byte_class[END_OF_INPUT + 1], class_byte[END_OF_INPUT + 1];
+	unsigned int entry;
+	int class_count = 0, byte, other, state, i;
+
+	if (TOKEN_END_OF_FILE >= 16)
+	{
+		fprintf(stderr, "Error! %d token types do not fit a table entry\n", TOKEN_END_OF_FILE + 1);
+		return 1;
+	}
+	for (state = 0; state < DFA_STATE_COUNT; state++)
+		for (byte = 0; byte <= END_OF_INPUT; byte++)
+			if ((entries[state][byte] = make_entry(state / 2, state % 2, byte)) == UNDEFINED_ENTRY)
+			{
+				if (byte == END_OF_INPUT)
+					fprintf(stderr, "Error! state %s takes the end of input\n", state_list[state / 2].name);
+				else
+					fprintf(stderr, "Error! state %s has no rule for byte %d, or takes it with RULE_USER_HEADER\n", state_list[state / 2].name, byte);
+				return 1;
+			}
+
+	/* Bytes with the same column in every state share a class; the end of input gets the last one */
+	for (byte = 0; byte <= END_OF_INPUT; byte++)
+	{
+		for (i = 0; i < class_count && byte != END_OF_INPUT; i++)
+		{
+			other = class_byte[i];
+			for (state = 0; state < DFA_STATE_COUNT && entries[state][byte] == entries[state][other]; state++)
+				;
+			if (state == DFA_STATE_COUNT)
+				break;
+		}
+		if (i == class_count || byte == END_OF_INPUT)
+		{
+			i = class_count++;
+			class_byte[i] = byte;
+		}
+		byte_class[byte] = i;
+	}
+	if ((unsigned int)(DFA_STATE_COUNT * class_count) > ROW_MASK + 1)
+	{
+		fprintf(stderr, "Error! %d states of %d classes do not fit a table entry\n", DFA_STATE_COUNT, class_count);
+		return 1;
+	}
+
+	printf("/* Generated by s2html_dfagen from s2html_lexer.def - do not edit */\n\n");
+	printf("#ifndef S2HTML_DFA_H\n#define S2HTML_DFA_H\n\n");
+	printf("#define DFA_STATE_COUNT\t\t\t%d\t\t/* specification states, each without and with the space flag */\n", DFA_STATE_COUNT);
+	printf("#define DFA_CLASS_COUNT\t\t\t%d\n", class_count);
+	printf("#define DFA_CLASS_END\t\t\t%d\t\t/* column read at the end of input */\n", class_count - 1);
+	printf("#define DFA_START_STATE\t\t\t%d\t\t/* row offset, as every state in an entry */\n\n", STATE_IDLE * 2 * class_count);
+	printf("/* Entry: row of the next state, then action, token type emitted, attribute and keyword flags. An entry at most\n");
+	printf("   DFA_ROW_MASK only takes the byte, and is the next row itself */\n");
+	printf("#define DFA_ROW_MASK\t\t\t0x%x\n", ROW_MASK);
+	printf("#define DFA_ACTION_SHIFT\t\t%d\n", ACTION_SHIFT);
+	printf("#define DFA_ACTION_MASK\t\t\t0x7\n");
+	printf("#define DFA_TOKEN_SHIFT\t\t\t%d\n", TOKEN_SHIFT);
+	printf("#define DFA_TOKEN_MASK\t\t\t0xf\n");
+	printf("#define DFA_USER_HEADER\t\t\t0x%xu\t/* the token's attribute becomes USER_DEFINED_HEADER */\n", USER_HEADER_BIT);
+	printf("#define DFA_CLASSIFY\t\t\t0x%xu\t/* the token goes through the keyword table */\n\n", CLASSIFY_BIT);
+	printf("/* Per action: bytes read that the token leaves out, and bytes read again for the next token */\n");
+	printf("static const unsigned char dfa_excluded[%d] = {", ACTION_COUNT);
+	for (i = 0; i < ACTION_COUNT; i++)
+		printf("%s%d", i ? ", " : "", action_list[i].excluded);
+	printf("};\nstatic const unsigned char dfa_reread[%d] = {", ACTION_COUNT);
+	for (i = 0; i < ACTION_COUNT; i++)
+		printf("%s%d", i ? ", " : "", action_list[i].reread);
+	printf("};\n\n");
+
+	printf("static const unsigned char dfa_byte_class[256] = {");
+	for (byte = 0; byte < END_OF_INPUT; byte++)
+		printf("%s%d,", byte % 16 ? " " : "\n\t", byte_class[byte]);
+	printf("\n};\n\n");
+
+	printf("static const unsigned int dfa_transitions[DFA_STATE_COUNT * DFA_CLASS_COUNT] = {\n");
+	for (state = 0; state < DFA_STATE_COUNT; state++)
+	{
+		printf("\t/* %s%s */\n\t", state_list[state / 2].name, state % 2 ? ", spaced" : "");
+		for (i = 0; i < class_count; i++)
+		{
+			entry = entries[state][class_byte[i]];
+			printf("0x%07x,%s", (entry & ~ROW_MASK) | (entry & ROW_MASK) * class_count, i + 1 < class_count ? (i % 8 == 7 ? "\n\t" : " ") : "\n");
+		}
+	}
+	printf("};\n\n#endif\n/**** End of file ****/\n");
+	return 0;
+}
@@ -0,0 +1,133 @@
+#include <stddef.h>
+#include "s2html_escape.h"
+
+#ifdef ESCAPE_HAVE_X86_KERNELS
+#include <immintrin.h>
+
+/* Kernel chosen on first use, NULL before. Threads that race to resolve it all store the same pointer, atomically */
+static escape_scan_fn selected_kernel;
+
+/********** Helper function implementations **********/
+
+/* Picks the widest kernel the running CPU has: AVX2 takes long clean runs in half the steps of SSE2 and finishes a
+   short run with the same 16 byte compare. s2html_bench times every kernel to check the choice on a given machine */
+static escape_scan_fn select_escape_kernel(void)
+{
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return escape_scan_avx2;
+	if (__builtin_cpu_supports("sse2"))
+		return escape_scan_sse2;
+	return escape_scan_scalar;
+}
+
+#endif
+
+/* ********************************************************************************************************************** */
+/* ********************************************************************************************************************** */
+
+escape_scan_fn select_escape_scan(void)
+{
+#ifdef ESCAPE_HAVE_X86_KERNELS
+	escape_scan_fn kernel = __atomic_load_n(&selected_kernel, __ATOMIC_RELAXED);
+
+	if (kernel == NULL)
+	{
+		kernel = select_escape_kernel();
+		__atomic_store_n(&selected_kernel, kernel, __ATOMIC_RELAXED);
+	}
+	return kernel;
+#else
+	return escape_scan_scalar;
+#endif
+}
+
+const char *escape_scan_kernel_name(void)
+{
+#ifdef ESCAPE_HAVE_X86_KERNELS
+	if (select_escape_scan() == escape_scan_avx2)
+		return "avx2";
+	if (select_escape_scan() == escape_scan_sse2)
+		return "sse2";
+#endif
+	return "scalar";
+}
+
+/********** Kernel implementations **********/
+
+size_t escape_scan_scalar(const char *text, size_t length)
+{
+	size_t i;
+	for (i = 0; i < length; i++)
+	{
+		switch (text[i])
+		{
+		case '<':
+		case '>':
+		case '&':
+		case '\n':
+			return i;
+		default:
+			break;
+		}
+	}
+	return length;
+}
+
+#ifdef ESCAPE_HAVE_X86_KERNELS
+
+__attribute__((target("sse2")))
+size_t escape_scan_sse2(const char *text, size_t length)
+{
+	const __m128i less_than = _mm_set1_epi8('<');
+	const __m128i greater_than = _mm_set1_epi8('>');
+	const __m128i ampersand = _mm_set1_epi8('&');
+	const __m128i newline = _mm_set1_epi8('\n');
+	size_t i;
+
+	for (i = 0; i + 16 <= length; i += 16)
+	{
+		__m128i chunk = _mm_loadu_si128((const __m128i *)(text + i));
+		__m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, less_than), _mm_cmpeq_epi8(chunk, greater_than)),
+									_mm_or_si128(_mm_cmpeq_epi8(chunk, ampersand), _mm_cmpeq_epi8(chunk, newline)));
+		unsigned int mask = (unsigned int)_mm_movemask_epi8(hits);
+		if (mask)
+			return i + __builtin_ctz(mask);
+	}
+	return i + escape_scan_scalar(text + i, length - i);
+}
+
+__attribute__((target("avx2")))
+size_t escape_scan_avx2(const char *text, size_t length)
+{
+	const __m256i less_than = _mm256_set1_epi8('<');
+	const __m256i greater_than = _mm256_set1_epi8('>');
+	const __m256i ampersand = _mm256_set1_epi8('&');
+	const __m256i newline = _mm256_set1_epi8('\n');
+	size_t i;
+
+	for (i = 0; i + 32 <= length; i += 32)
+	{
+		__m256i chunk = _mm256_loadu_si256((const __m256i *)(text + i));
+		__m256i hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, less_than), _mm256_cmpeq_epi8(chunk, greater_than)),
+									   _mm256_or_si256(_mm256_cmpeq_epi8(chunk, ampersand), _mm256_cmpeq_epi8(chunk, newline)));
+		unsigned int mask = (unsigned int)_mm256_movemask_epi8(hits);
+		if (mask)
+			return i + __builtin_ctz(mask);
+	}
+
+	/* Finish here rather than in the SSE2 kernel: mixing legacy SSE with dirty AVX state stalls */
+	if (i + 16 <= length)
+	{
+		__m128i chunk = _mm_loadu_si128((const __m128i *)(text + i));
+		__m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm256_castsi256_si128(less_than)), _mm_cmpeq_epi8(chunk, _mm256_castsi256_si128(greater_than))),
+									_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm256_castsi256_si128(ampersand)), _mm_cmpeq_epi8(chunk, _mm256_castsi256_si128(newline))));
+		unsigned int mask = (unsigned int)_mm_movemask_epi8(hits);
+		if (mask)
+			return i + __builtin_ctz(mask);
+		i += 16;
+	}
+	return i + escape_scan_scalar(text + i, length - i);
+}
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef S2HTML_ESCAPE_H
+#define S2HTML_ESCAPE_H
+
+#include <stddef.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define ESCAPE_HAVE_X86_KERNELS 1
+#endif
+
+/* Returns offset of the first '<', '>', '&' or '\n' in text, or length if there is none */
+typedef size_t (*escape_scan_fn)(const char *text, size_t length);
+
+/********** function prototypes **********/
+
+escape_scan_fn select_escape_scan(void);	/* the kernel for the running CPU, resolved once; callers keep the pointer */
+const char *escape_scan_kernel_name(void);
+
+/********** kernels **********/
+
+size_t escape_scan_scalar(const char *text, size_t length);
+#ifdef ESCAPE_HAVE_X86_KERNELS
+size_t escape_scan_sse2(const char *text, size_t length);
+size_t escape_scan_avx2(const char *text, size_t length);
+#endif
+
+#endif
+/**** End of file ****/
@@ -2,58 +2,77 @@
 #include <string.h>
 #include <stdlib.h>
 #include "s2html_event.h"
+#include "s2html_stats.h"
+#include "s2html_arena.h"
 
-#define SYMBOL_COUNT (sizeof(delimiter_chars))
-#define OPERATOR_COUNT (sizeof(operator_chars))
-#define TEMP_BUFFER_SIZE 100
+/* C language keyword table, generated from s2html_keywords.def */
+#include "s2html_keywords.h"
 
-/********** Parser state definitions **********/
+/********** Character class tables **********/
+
+/* Lead class: what a byte starts when it is read in the idle state */
 typedef enum
 {
-	PARSE_STATE_IDLE,
-	PARSE_STATE_PREPROCESSOR_DIRECTIVE,
-	PARSE_STATE_SUB_PREPROCESSOR_MAIN,
-	PARSE_STATE_SUB_PREPROCESSOR_RESERVE_KEYWORD,
-	PARSE_STATE_SUB_PREPROCESSOR_ASCII_CHAR,
-	PARSE_STATE_HEADER_FILE,
-	PARSE_STATE_RESERVE_KEYWORD,
-	PARSE_STATE_NUMERIC_CONSTANT,
-	PARSE_STATE_STRING,
-	PARSE_STATE_SINGLE_LINE_COMMENT,
-	PARSE_STATE_MULTI_LINE_COMMENT,
-	PARSE_STATE_FORMAT_SPECIFIER,
-	PARSE_STATE_OPERATORS,
-	PARSE_STATE_SYMBOLS,
-	PARSE_STATE_ASCII_CHAR
-} parser_state_t;
-
-/********** Global state variables **********/
-
-/* Current parser state */
-static parser_state_t current_state = PARSE_STATE_IDLE;
-
-/* Sub-state for preprocessor parsing */
-static parser_state_t preprocessor_substate = PARSE_STATE_SUB_PREPROCESSOR_MAIN;
-
-/* Token data storage */
-static parser_token_t current_token;
-static int token_buffer_index = 0;
-
-static char temporary_word[TEMP_BUFFER_SIZE];
-static int word_buffer_index = 0;
-
-/* C language keyword tables */
-static char *datatype_keywords[] = {"const", "volatile", "extern", "auto", "register",
-									"static", "signed", "unsigned", "short", "long",
-									"double", "char", "int", "float", "struct",
-									"union", "enum", "void", "typedef", ""};
-
-static char *control_keywords[] = {"goto", "return", "continue", "break",
-								   "if", "else", "for", "while", "do",
-								   "switch", "case", "default", "sizeof", ""};
-
-static char operator_chars[] = {'/', '+', '*', '-', '%', '=', '<', '>', '~', '&', ',', '!', '^', '|'};
-static char delimiter_chars[] = {'(', ')', '{', '}', '[', ']', ':'};
+	LEAD_OTHER,				/* whitespace and anything else, accumulated as regular text */
+	LEAD_IDENTIFIER,		/* a-z A-Z _ */
+	LEAD_DIGIT,				/* 0-9 */
+	LEAD_OPERATOR,			/* + - * % = < > ~ & , ! ^ | */
+	LEAD_DELIMITER,			/* ( ) { } [ ] : */
+	LEAD_SLASH,				/* / => comment or operator */
+	LEAD_HASH,				/* # */
+	LEAD_DOUBLE_QUOTE,		/* " */
+	LEAD_SINGLE_QUOTE		/* ' */
+} lead_class_t;
+
+static const unsigned char char_lead_class[256] = {
+	['a' ... 'z'] = LEAD_IDENTIFIER,
+	['A' ... 'Z'] = LEAD_IDENTIFIER,
+	['_'] = LEAD_IDENTIFIER,
+	['0' ... '9'] = LEAD_DIGIT,
+	['+'] = LEAD_OPERATOR, ['-'] = LEAD_OPERATOR, ['*'] = LEAD_OPERATOR, ['%'] = LEAD_OPERATOR,
+	['='] = LEAD_OPERATOR, ['<'] = LEAD_OPERATOR, ['>'] = LEAD_OPERATOR, ['~'] = LEAD_OPERATOR,
+	['&'] = LEAD_OPERATOR, [','] = LEAD_OPERATOR, ['!'] = LEAD_OPERATOR, ['^'] = LEAD_OPERATOR,
+	['|'] = LEAD_OPERATOR,
+	['('] = LEAD_DELIMITER, [')'] = LEAD_DELIMITER, ['{'] = LEAD_DELIMITER, ['}'] = LEAD_DELIMITER,
+	['['] = LEAD_DELIMITER, [']'] = LEAD_DELIMITER, [':'] = LEAD_DELIMITER,
+	['/'] = LEAD_SLASH,
+	['#'] = LEAD_HASH,
+	['"'] = LEAD_DOUBLE_QUOTE,
+	['\''] = LEAD_SINGLE_QUOTE,
+};
+
+/* Class flags: how a byte behaves inside the other states */
+#define CHAR_OPERATOR			0x01	/* continues an operator run */
+#define CHAR_DELIMITER			0x02	/* continues a symbol run */
+#define CHAR_DIGIT				0x04
+#define CHAR_LETTER				0x08	/* a-z A-Z, ends the space run of a preprocessor directive */
+#define CHAR_ENDS_KEYWORD		0x10	/* terminates an identifier */
+#define CHAR_ENDS_NUMBER		0x20	/* terminates a numeric constant */
+#define CHAR_ENDS_FORMAT		0x40	/* terminates a format specifier */
+
+#define OPERATOR_FLAGS			(CHAR_OPERATOR | CHAR_ENDS_KEYWORD)
+#define DELIMITER_FLAGS			(CHAR_DELIMITER | CHAR_ENDS_KEYWORD)
+
+static const unsigned char char_flags[256] = {
+	['a' ... 'z'] = CHAR_LETTER,
+	['A' ... 'Z'] = CHAR_LETTER,
+	['0' ... '9'] = CHAR_DIGIT | CHAR_ENDS_KEYWORD,
+	['/'] = OPERATOR_FLAGS, ['+'] = OPERATOR_FLAGS, ['*'] = OPERATOR_FLAGS, ['-'] = OPERATOR_FLAGS,
+	['%'] = OPERATOR_FLAGS, ['='] = OPERATOR_FLAGS, ['<'] = OPERATOR_FLAGS, ['>'] = OPERATOR_FLAGS,
+	['~'] = OPERATOR_FLAGS, ['&'] = OPERATOR_FLAGS, ['!'] = OPERATOR_FLAGS, ['^'] = OPERATOR_FLAGS,
+	['|'] = OPERATOR_FLAGS,
+	[','] = OPERATOR_FLAGS | CHAR_ENDS_NUMBER,
+	['('] = DELIMITER_FLAGS, ['{'] = DELIMITER_FLAGS, ['['] = DELIMITER_FLAGS, [':'] = DELIMITER_FLAGS,
+	[')'] = DELIMITER_FLAGS | CHAR_ENDS_NUMBER,
+	['}'] = DELIMITER_FLAGS | CHAR_ENDS_NUMBER,
+	[']'] = DELIMITER_FLAGS | CHAR_ENDS_NUMBER,
+	[' '] = CHAR_ENDS_KEYWORD | CHAR_ENDS_NUMBER | CHAR_ENDS_FORMAT,
+	['\t'] = CHAR_ENDS_KEYWORD | CHAR_ENDS_NUMBER,
+	['\n'] = CHAR_ENDS_KEYWORD | CHAR_ENDS_NUMBER,
+	[';'] = CHAR_ENDS_KEYWORD | CHAR_ENDS_NUMBER,
+	['"'] = CHAR_ENDS_FORMAT,
+	['\\'] = CHAR_ENDS_FORMAT,
+};
 
 /* ********************************************************************************************************************** */
 /* ********************************************************************************************************************** */
@@ -62,64 +81,165 @@ static char delimiter_chars[] = {'(', ')', '{', '}', '[', ']', ':'};
 
 /********** Helper function implementations **********/
 
-/* Determines if a word matches C language keywords */
-static int classify_keyword(char *word_to_check)
+/* Determines if a word matches C language keywords: one hash and at most one memcmp */
+int classify_keyword(const char *word_to_check, size_t length)
 {
-	int array_index = 0;
+	const keyword_slot_t *slot;
 
-	/* Check datatype keywords first */
-	while (*datatype_keywords[array_index])
-	{
-		if (strcmp(datatype_keywords[array_index++], word_to_check) == 0)
-		{
-			return DATATYPE_KEYWORD;
-		}
-	}
+	if (length < KEYWORD_MIN_LENGTH || length > KEYWORD_MAX_LENGTH)
+		return TOKEN_REGULAR_TEXT;
 
-	array_index = 0; /* Reset for next search */
-	/* Check control flow keywords */
-	while (*control_keywords[array_index])
+	slot = &keyword_table[keyword_hash(word_to_check, length)];
+	if (slot->length == length && memcmp(slot->word, word_to_check, length) == 0)
 	{
-		if (strcmp(control_keywords[array_index++], word_to_check) == 0)
-		{
-			return CONTROL_KEYWORD;
-		}
+		return slot->classification;
 	}
 	return TOKEN_REGULAR_TEXT; /* Not a keyword, treat as regular text */
 }
 
 /* Checks if character is a delimiter/symbol */
-static int is_delimiter_char(char character)
+static inline int is_delimiter_char(int character)
 {
-	int i;
-	for (i = 0; i < SYMBOL_COUNT; i++)
-	{
-		if (delimiter_chars[i] == character)
-			return 1;
-	}
-	return 0;
+	return char_flags[character] & CHAR_DELIMITER;
 }
 
 /* Checks if character is an operator */
-static int is_operator_char(char character)
+static inline int is_operator_char(int character)
 {
-	int i;
-	for (i = 0; i < OPERATOR_COUNT; i++)
-	{
-		if (operator_chars[i] == character)
-			return 1;
-	}
-	return 0;
+	return char_flags[character] & CHAR_OPERATOR;
+}
+
+#ifdef S2HTML_STATS
+/* Bytes consumed so far, across stream window slides; a read past the end is not a byte */
+static inline unsigned long long source_offset(const source_buffer_t *source)
+{
+	return source->discarded + (source->position < source->length ? source->position : source->length);
+}
+#endif
+
+/* Steps the cursor back over the last count bytes read */
+static inline void rewind_source(s2html_lexer_t *lexer, size_t count)
+{
+	STATS_ADD(lexer->stats, rewinds, 1);
+	STATS_ADD(lexer->stats, rewound_bytes, count);
+	source_unget(lexer->source, count);
+}
+
+/* Adds the last count bytes read to the current token; token bytes are contiguous in the source, so only the extent is kept */
+static inline void append_token_chars(s2html_lexer_t *lexer, size_t count)
+{
+	if (lexer->token_buffer_index == 0)
+		lexer->source->pinned = lexer->source->position - count;
+	lexer->token_buffer_index += count;
+}
+
+/* Appends the bytes following the cursor up to the first one with any of stop_flags; the cursor is left on that byte (the token is already started) */
+static void accumulate_until(s2html_lexer_t *lexer, unsigned char stop_flags)
+{
+	int current_char;
+
+	while ((current_char = source_next_char(lexer->source)) != SOURCE_EOF && !(char_flags[current_char] & stop_flags))
+		lexer->token_buffer_index++;
+	rewind_source(lexer, 1);
+}
+
+/* Appends the bytes following the cursor while they have class_flag; the cursor is left on the first other byte (the token is already started) */
+static void accumulate_while(s2html_lexer_t *lexer, unsigned char class_flag)
+{
+	int current_char;
+
+	while ((current_char = source_next_char(lexer->source)) != SOURCE_EOF && (char_flags[current_char] & class_flag))
+		lexer->token_buffer_index++;
+	rewind_source(lexer, 1);
+}
+
+/* Adds the buffered bytes from the cursor up to end, a pointer into the buffer, to the token already started; the
+   cursor is left on end */
+static inline void append_run(s2html_lexer_t *lexer, const char *end)
+{
+	size_t count = end - (lexer->source->data + lexer->source->position);
+
+	lexer->source->position += count;
+	lexer->token_buffer_index += count;
+}
+
+/* Fast path of a state whose body bytes all append the same way: takes the buffered bytes before the next target (or,
+   when second is not SOURCE_EOF, the next of either target) with memchr instead of one dispatch per byte. The cursor
+   is left on the target for its state handler; with no target buffered every byte is taken and the handler continues
+   after the refill */
+static void append_until_byte(s2html_lexer_t *lexer, int target, int second)
+{
+	source_buffer_t *source = lexer->source;
+	const char *from, *found, *other;
+	size_t length;
+
+	if (lexer->byte_at_a_time || source->position >= source->length)
+		return;
+	from = source->data + source->position;
+	length = source->length - source->position;
+	if (NULL != (found = memchr(from, target, length)))
+		length = found - from;
+	if (second != SOURCE_EOF && NULL != (other = memchr(from, second, length)))
+		found = other;
+	append_run(lexer, found ? found : from + length);
 }
 
 /* Finalizes current token and prepares for next one */
-static void finalize_token(parser_state_t next_state, token_type_t token_type)
+static void finalize_token(s2html_lexer_t *lexer, parser_state_t next_state, token_type_t token_type)
 {
-	current_token.content[token_buffer_index] = '\0'; /* Null terminate string */
-	current_token.size = token_buffer_index;		  /* Store string length */
-	token_buffer_index = 0;							  /* Reset buffer index */
-	current_state = next_state;						  /* Update parser state */
-	current_token.type = token_type;				  /* Set token type */
+	lexer->current_token.content = lexer->token_buffer_index ? lexer->source->data + lexer->source->pinned : "";
+	lexer->current_token.size = lexer->token_buffer_index;			/* Store string length */
+	lexer->token_buffer_index = 0;									/* Reset buffer index */
+	lexer->source->pinned = SOURCE_UNPINNED;						/* the window may drop the bytes once the token is used */
+	lexer->current_state = next_state;								/* Update parser state */
+	lexer->current_token.type = token_type;						/* Set token type */
+}
+
+/* Ends an identifier before the byte just read, which next_state handles, and classifies it */
+static parser_token_t *finalize_keyword_token(s2html_lexer_t *lexer, parser_state_t next_state)
+{
+	int keyword_classification;
+
+	rewind_source(lexer, 1);
+	finalize_token(lexer, next_state, TOKEN_RESERVE_KEYWORD);
+	keyword_classification = classify_keyword(lexer->current_token.content, lexer->current_token.size);
+	if (keyword_classification == DATATYPE_KEYWORD)
+		lexer->current_token.attribute = DATATYPE_KEYWORD;
+	else if (keyword_classification == CONTROL_KEYWORD)
+		lexer->current_token.attribute = CONTROL_KEYWORD;
+	else
+		lexer->current_token.type = TOKEN_REGULAR_TEXT;
+	return &lexer->current_token;
+}
+
+/* Resizes one column of table from table->capacity to capacity entries of size bytes; returns NULL when out of memory */
+static void *resize_token_column(token_table_t *table, void *column, size_t size, size_t capacity)
+{
+	if (table->arena)
+		return arena_grow(table->arena, column, table->capacity * size, capacity * size);
+	return realloc(column, capacity * size);
+}
+
+/* Resizes every column of table to capacity tokens; returns 0 when out of memory (the table stays usable) */
+static int resize_token_table(token_table_t *table, size_t capacity)
+{
+	unsigned char *types, *attributes;
+	size_t *offsets, *lengths;
+
+	if (NULL == (types = resize_token_column(table, table->types, sizeof(*types), capacity)))
+		return 0;
+	table->types = types;
+	if (NULL == (attributes = resize_token_column(table, table->attributes, sizeof(*attributes), capacity)))
+		return 0;
+	table->attributes = attributes;
+	if (NULL == (offsets = resize_token_column(table, table->offsets, sizeof(*offsets), capacity)))
+		return 0;
+	table->offsets = offsets;
+	if (NULL == (lengths = resize_token_column(table, table->lengths, sizeof(*lengths), capacity)))
+		return 0;
+	table->lengths = lengths;
+	table->capacity = capacity;
+	return 1;
 }
 
 /* ********************************************************************************************************************** */
@@ -129,79 +249,210 @@ static void finalize_token(parser_state_t next_state, token_type_t token_type)
 
 /********** Main parser function **********/
 
+/* Prepares lexer to tokenize source from the beginning */
+void init_lexer(s2html_lexer_t *lexer, source_buffer_t *source)
+{
+	memset(lexer, 0, sizeof(*lexer));
+	lexer->source = source;
+	lexer->current_state = PARSE_STATE_IDLE;
+	lexer->preprocessor_substate = PARSE_STATE_SUB_PREPROCESSOR_MAIN;
+	lexer->space_encountered = 1;
+}
+
+/* Records the state after the token extract_next_token just returned (the token buffer is empty there) */
+void save_lexer_checkpoint(const s2html_lexer_t *lexer, lexer_checkpoint_t *checkpoint)
+{
+	checkpoint->position = lexer->source->position;
+	checkpoint->current_state = lexer->current_state;
+	checkpoint->attribute = lexer->current_token.attribute;
+	checkpoint->space_encountered = lexer->space_encountered;
+}
+
+/* Moves lexer onto a saved token boundary of the same source bytes */
+void restore_lexer_checkpoint(s2html_lexer_t *lexer, const lexer_checkpoint_t *checkpoint)
+{
+	lexer->source->position = checkpoint->position;
+	lexer->current_state = checkpoint->current_state;
+	lexer->current_token.attribute = checkpoint->attribute;
+	lexer->space_encountered = checkpoint->space_encountered;
+	lexer->token_buffer_index = 0;
+}
+
+/* Non-zero when both checkpoints resume into the same token sequence */
+int lexer_checkpoints_equal(const lexer_checkpoint_t *first, const lexer_checkpoint_t *second)
+{
+	return first->position == second->position && first->current_state == second->current_state &&
+		   first->attribute == second->attribute && first->space_encountered == second->space_encountered;
+}
+
+/* Prepares an empty table with room for expected_count tokens; returns 1 on success, 0 on failure */
+int init_token_table(token_table_t *table, size_t expected_count)
+{
+	memset(table, 0, sizeof(*table));
+	if (resize_token_table(table, expected_count ? expected_count : 1))
+		return 1;
+	free_token_table(table);
+	return 0;
+}
+
+/* Same as init_token_table with the arrays cut from arena: nothing to free, they go with the arena's next reset */
+int init_arena_token_table(token_table_t *table, size_t expected_count, struct s2html_arena *arena)
+{
+	memset(table, 0, sizeof(*table));
+	table->arena = arena;
+	return resize_token_table(table, expected_count ? expected_count : 1);
+}
+
+void free_token_table(token_table_t *table)
+{
+	if (table->arena)
+	{
+		memset(table, 0, sizeof(*table));
+		return;
+	}
+	free(table->types);
+	free(table->attributes);
+	free(table->offsets);
+	free(table->lengths);
+	memset(table, 0, sizeof(*table));
+}
+
+/* Lex pass: stores every token from the cursor of source on, up to and including TOKEN_END_OF_FILE, in table.
+   Offsets refer to source->data, so streams (whose window slides) are refused; returns 1 on success, 0 on failure */
+int lex_source_to_table(source_buffer_t *source, token_table_t *table)
+{
+	s2html_lexer_t lexer;
+	parser_token_t *token;
+	size_t count = 0;
+
+	if (source->origin == SOURCE_ORIGIN_STREAM)
+		return 0;
+
+	init_lexer(&lexer, source);
+	do
+	{
+		token = extract_next_token(&lexer);
+		if (count == table->capacity && !resize_token_table(table, table->capacity * 2))
+		{
+			table->count = count;
+			return 0;
+		}
+		table->types[count] = token->type;
+		table->attributes[count] = token->attribute;
+		table->offsets[count] = token->size ? (size_t)(token->content - source->data) : 0;
+		table->lengths[count] = token->size;
+		count++;
+	} while (token->type != TOKEN_END_OF_FILE);
+
+	table->count = count;
+	return 1;
+}
+
 /* Extracts and classifies the next token from input stream */
-parser_token_t *extract_next_token(FILE *input_stream)
+static inline parser_token_t *lex_next_token(s2html_lexer_t *lexer)
 {
 	int current_char, previous_char;
 	parser_token_t *token_pointer = NULL;
 
 	/* Process file character by character */
-	while ((current_char = fgetc(input_stream)) != EOF)
+	while ((current_char = source_next_char(lexer->source)) != SOURCE_EOF)
 	{
 
 #ifdef DEBUG
 		//	putchar(current_char);
 #endif
-		switch (current_state)
+#ifdef S2HTML_STATS
+		if (lexer->stats)
+		{
+			if ((int)lexer->current_state != lexer->stats->timed_state)
+				stats_enter_state(lexer->stats, lexer->current_state);
+			stats_count_bytes(lexer->stats, lexer->current_state, source_offset(lexer->source) - 1);
+		}
+#endif
+		switch (lexer->current_state)
 		{
 		case PARSE_STATE_IDLE:
-			if ((token_pointer = handle_idle_state(input_stream, current_char)) != NULL)
+			if ((token_pointer = handle_idle_state(lexer, current_char)) != NULL)
 				return token_pointer;
 			break;
 		case PARSE_STATE_SINGLE_LINE_COMMENT:
-			if ((token_pointer = handle_single_comment_state(input_stream, current_char)) != NULL)
+			if ((token_pointer = handle_single_comment_state(lexer, current_char)) != NULL)
 				return token_pointer;
 			break;
 		case PARSE_STATE_MULTI_LINE_COMMENT:
-			if ((token_pointer = handle_multi_comment_state(input_stream, current_char)) != NULL)
+			if ((token_pointer = handle_multi_comment_state(lexer, current_char)) != NULL)
 				return token_pointer;
 			break;
 		case PARSE_STATE_PREPROCESSOR_DIRECTIVE:
-			if ((token_pointer = handle_preprocessor_state(input_stream, current_char)) != NULL)
+			if ((token_pointer = handle_preprocessor_state(lexer, current_char)) != NULL)
 				return token_pointer;
 			break;
 		case PARSE_STATE_RESERVE_KEYWORD:
-			if ((token_pointer = handle_keyword_state(input_stream, current_char)) != NULL)
+			if ((token_pointer = handle_keyword_state(lexer, current_char)) != NULL)
 				return token_pointer;
 			break;
 		case PARSE_STATE_NUMERIC_CONSTANT:
-			if ((token_pointer = handle_number_state(input_stream, current_char)) != NULL)
+			if ((token_pointer = handle_number_state(lexer, current_char)) != NULL)
 				return token_pointer;
 			break;
 		case PARSE_STATE_STRING:
-			if ((token_pointer = handle_string_state(input_stream, current_char)) != NULL)
+			if ((token_pointer = handle_string_state(lexer, current_char)) != NULL)
 				return token_pointer;
 			break;
 		case PARSE_STATE_HEADER_FILE:
-			if ((token_pointer = handle_header_state(input_stream, current_char)) != NULL)
+			if ((token_pointer = handle_header_state(lexer, current_char)) != NULL)
 				return token_pointer;
 			break;
 		case PARSE_STATE_ASCII_CHAR:
-			if ((token_pointer = handle_ascii_state(input_stream, current_char)) != NULL)
+			if ((token_pointer = handle_ascii_state(lexer, current_char)) != NULL)
 				return token_pointer;
 			break;
 		case PARSE_STATE_FORMAT_SPECIFIER:
-			if ((token_pointer = handle_format_specifier_state(input_stream, current_char)) != NULL)
+			if ((token_pointer = handle_format_specifier_state(lexer, current_char)) != NULL)
 				return token_pointer;
 			break;
 		case PARSE_STATE_OPERATORS:
-			if ((token_pointer = handle_operator_state(input_stream, current_char)) != NULL)
+			if ((token_pointer = handle_operator_state(lexer, current_char)) != NULL)
 				return token_pointer;
 			break;
 		case PARSE_STATE_SYMBOLS:
-			if ((token_pointer = handle_symbol_state(input_stream, current_char)) != NULL)
+			if ((token_pointer = handle_symbol_state(lexer, current_char)) != NULL)
 				return token_pointer;
 			break;
 		default:
+#ifdef DEBUG
 			printf("ERROR: Unknown parser state encountered\n");
-			current_state = PARSE_STATE_IDLE;
+#endif
+			lexer->current_state = PARSE_STATE_IDLE;
 			break;
 		}
 	}
 
 	/* Handle end of file */
-	finalize_token(PARSE_STATE_IDLE, TOKEN_END_OF_FILE);
-	return &current_token;
+	finalize_token(lexer, PARSE_STATE_IDLE, TOKEN_END_OF_FILE);
+	return &lexer->current_token;
+}
+
+/* Public entry: lex_next_token, timed per state when counting, or the table driven engine when selected */
+parser_token_t *extract_next_token(s2html_lexer_t *lexer)
+{
+#ifdef S2HTML_STATS
+	parser_token_t *token;
+#endif
+
+	if (lexer->table_driven)
+		return extract_next_token_dfa(lexer);
+#ifdef S2HTML_STATS
+	if (lexer->stats)
+	{
+		stats_start_timer(lexer->stats, lexer->current_state);
+		token = lex_next_token(lexer);
+		stats_count_bytes(lexer->stats, -1, source_offset(lexer->source));
+		stats_stop_timer(lexer->stats);
+		return token;
+	}
+#endif
+	return lex_next_token(lexer);
 }
 
 /* ********************************************************************************************************************** */
@@ -211,151 +462,155 @@ parser_token_t *extract_next_token(FILE *input_stream)
 
 /********** State handler implementations **********/
 
-parser_token_t *handle_idle_state(FILE *input_stream, int current_char)
+parser_token_t *handle_idle_state(s2html_lexer_t *lexer, int current_char)
 {
-	int next_char;
-	switch (current_char)
+	const unsigned char *run, *run_end;
+
+	switch (char_lead_class[current_char])
 	{
-	case '\'': /* ASCII character literal start */
-		if (token_buffer_index)		/* single quote while it's already in the middle of accumulating regular text - eg: variable_name'a' */
+	case LEAD_SINGLE_QUOTE: /* ASCII character literal start */
+		if (lexer->token_buffer_index)		/* single quote while it's already in the middle of accumulating regular text - eg: variable_name'a' */
 		{
-			fseek(input_stream, -1L, SEEK_CUR); /* Rewind one character */
-			finalize_token(PARSE_STATE_IDLE, TOKEN_REGULAR_TEXT);
-			return &current_token;
+			rewind_source(lexer, 1); /* Rewind one character */
+			finalize_token(lexer, PARSE_STATE_IDLE, TOKEN_REGULAR_TEXT);
+			return &lexer->current_token;
 		}
 		else
 		{
-			current_state = PARSE_STATE_ASCII_CHAR;
-			current_token.content[token_buffer_index++] = current_char;
+			lexer->current_state = PARSE_STATE_ASCII_CHAR;
+			append_token_chars(lexer, 1);
 			break;
 		}
-	case '/':
-		next_char = current_char;
-		if ((current_char = fgetc(input_stream)) == '*') /* Multi-line comment start */
+	case LEAD_SLASH:
+		if ((current_char = source_next_char(lexer->source)) == '*') /* Multi-line comment start */
 		{
-			if (token_buffer_index) /* Process pending regular text first */
+			if (lexer->token_buffer_index) /* Process pending regular text first */
 			{
-				fseek(input_stream, -2L, SEEK_CUR); /* Rewind both characters */
-				finalize_token(PARSE_STATE_IDLE, TOKEN_REGULAR_TEXT);
-				return &current_token;
+				rewind_source(lexer, 2); /* Rewind both characters */
+				finalize_token(lexer, PARSE_STATE_IDLE, TOKEN_REGULAR_TEXT);
+				return &lexer->current_token;
 			}
 			else /* Begin multi-line comment parsing */
 			{
 #ifdef DEBUG
 				printf("Multi line comment Begin : /*\n");
 #endif
-				current_state = PARSE_STATE_MULTI_LINE_COMMENT;
-				current_token.content[token_buffer_index++] = next_char;
-				current_token.content[token_buffer_index++] = current_char;
+				lexer->current_state = PARSE_STATE_MULTI_LINE_COMMENT;
+				append_token_chars(lexer, 2);
 			}
 		}
 		else if (current_char == '/') /* Single-line comment start */
 		{
-			if (token_buffer_index) /* Process pending regular text first */
+			if (lexer->token_buffer_index) /* Process pending regular text first */
 			{
-				fseek(input_stream, -2L, SEEK_CUR); /* Rewind both characters */
-				finalize_token(PARSE_STATE_IDLE, TOKEN_REGULAR_TEXT);
-				return &current_token;
+				rewind_source(lexer, 2); /* Rewind both characters */
+				finalize_token(lexer, PARSE_STATE_IDLE, TOKEN_REGULAR_TEXT);
+				return &lexer->current_token;
 			}
 			else /* Begin single-line comment parsing */
 			{
 #ifdef DEBUG
 				printf("Single line comment Begin : //\n");
 #endif
-				current_state = PARSE_STATE_SINGLE_LINE_COMMENT;
-				current_token.content[token_buffer_index++] = next_char;
-				current_token.content[token_buffer_index++] = current_char;
+				lexer->current_state = PARSE_STATE_SINGLE_LINE_COMMENT;
+				append_token_chars(lexer, 2);
 			}
 		}
 		else /* Regular division operator */
 		{
-			current_token.content[token_buffer_index++] = next_char;
-			current_token.content[token_buffer_index++] = current_char;
+			if (current_char != SOURCE_EOF)
+			{
+				append_token_chars(lexer, 2);
+			}
+			else
+			{
+				rewind_source(lexer, 1);
+				append_token_chars(lexer, 1);
+			}
 		}
 		break;
-	case '#': /* Preprocessor directive */
-		if (token_buffer_index)
+	case LEAD_HASH: /* Preprocessor directive */
+		if (lexer->token_buffer_index)
 		{
-			fseek(input_stream, -1L, SEEK_CUR); /* Rewind character */
-			finalize_token(PARSE_STATE_IDLE, TOKEN_REGULAR_TEXT);
-			return &current_token;
+			rewind_source(lexer, 1); /* Rewind character */
+			finalize_token(lexer, PARSE_STATE_IDLE, TOKEN_REGULAR_TEXT);
+			return &lexer->current_token;
 		}
 		else
 		{
-			current_state = PARSE_STATE_PREPROCESSOR_DIRECTIVE;
-			current_token.content[token_buffer_index++] = current_char;
+			lexer->current_state = PARSE_STATE_PREPROCESSOR_DIRECTIVE;
+			append_token_chars(lexer, 1);
 		}
 		break;
-	case '\"': /* String literal start */
-		if (token_buffer_index)
+	case LEAD_DOUBLE_QUOTE: /* String literal start */
+		if (lexer->token_buffer_index)
 		{
-			fseek(input_stream, -1L, SEEK_CUR); /* Rewind character */
-			finalize_token(PARSE_STATE_IDLE, TOKEN_REGULAR_TEXT);
-			return &current_token;
+			rewind_source(lexer, 1); /* Rewind character */
+			finalize_token(lexer, PARSE_STATE_IDLE, TOKEN_REGULAR_TEXT);
+			return &lexer->current_token;
 		}
 		else
 		{
-			current_state = PARSE_STATE_STRING;
-			current_token.content[token_buffer_index++] = current_char;
+			lexer->current_state = PARSE_STATE_STRING;
+			append_token_chars(lexer, 1);
 		}
 		break;
 
-	case '0' ... '9': /* Numeric constant detection */
-		if (token_buffer_index)
+	case LEAD_DIGIT: /* Numeric constant detection */
+		if (lexer->token_buffer_index)
 		{
-			fseek(input_stream, -1L, SEEK_CUR); /* Rewind character */
-			finalize_token(PARSE_STATE_IDLE, TOKEN_REGULAR_TEXT);
-			return &current_token;
+			rewind_source(lexer, 1); /* Rewind character */
+			finalize_token(lexer, PARSE_STATE_IDLE, TOKEN_REGULAR_TEXT);
+			return &lexer->current_token;
 		}
 		else
 		{
-			current_state = PARSE_STATE_NUMERIC_CONSTANT;
-			current_token.content[token_buffer_index++] = current_char;
+			lexer->current_state = PARSE_STATE_NUMERIC_CONSTANT;
+			append_token_chars(lexer, 1);
 		}
 		break;
 
-	case 'a' ... 'z': /* Potential keyword detection */
-	case 'A' ... 'Z':
-	case '_':
-		if (token_buffer_index)
+	case LEAD_IDENTIFIER: /* Potential keyword detection */
+		if (lexer->token_buffer_index)
 		{
-			fseek(input_stream, -1L, SEEK_CUR); /* Rewind character */
-			finalize_token(PARSE_STATE_IDLE, TOKEN_REGULAR_TEXT);
-			return &current_token;
+			rewind_source(lexer, 1); /* Rewind character */
+			finalize_token(lexer, PARSE_STATE_IDLE, TOKEN_REGULAR_TEXT);
+			return &lexer->current_token;
 		}
 		else
 		{
-			current_state = PARSE_STATE_RESERVE_KEYWORD;
-			current_token.content[token_buffer_index++] = current_char;
+			lexer->current_state = PARSE_STATE_RESERVE_KEYWORD;
+			append_token_chars(lexer, 1);
 		}
 		break;
-	default: /* Handle operators, symbols, and other text */
-		if (is_operator_char(current_char) && token_buffer_index > 0)
-		{
-			fseek(input_stream, -1L, SEEK_CUR); /* Rewind character */
-			finalize_token(PARSE_STATE_OPERATORS, TOKEN_REGULAR_TEXT);
-			return &current_token;
-		}
-		else if (is_delimiter_char(current_char) && token_buffer_index > 0)
-		{
-			fseek(input_stream, -1L, SEEK_CUR); /* Rewind character */
-			finalize_token(PARSE_STATE_SYMBOLS, TOKEN_REGULAR_TEXT);
-			return &current_token;
-		}
-		else if (is_operator_char(current_char))
-		{
-			current_state = PARSE_STATE_OPERATORS;
-			current_token.content[token_buffer_index++] = current_char;
-		}
-		else if (is_delimiter_char(current_char))
+	case LEAD_OPERATOR: /* Operator sequence start */
+		if (lexer->token_buffer_index > 0)
 		{
-			current_state = PARSE_STATE_SYMBOLS;
-			current_token.content[token_buffer_index++] = current_char;
+			rewind_source(lexer, 1); /* Rewind character */
+			finalize_token(lexer, PARSE_STATE_OPERATORS, TOKEN_REGULAR_TEXT);
+			return &lexer->current_token;
 		}
-		else
+		lexer->current_state = PARSE_STATE_OPERATORS;
+		append_token_chars(lexer, 1);
+		break;
+	case LEAD_DELIMITER: /* Symbol sequence start */
+		if (lexer->token_buffer_index > 0)
 		{
-			current_token.content[token_buffer_index++] = current_char;
+			rewind_source(lexer, 1); /* Rewind character */
+			finalize_token(lexer, PARSE_STATE_SYMBOLS, TOKEN_REGULAR_TEXT);
+			return &lexer->current_token;
 		}
+		lexer->current_state = PARSE_STATE_SYMBOLS;
+		append_token_chars(lexer, 1);
+		break;
+	default: /* Whitespace and other text: take the buffered run directly, the next read continues it after a refill */
+		append_token_chars(lexer, 1);
+		if (lexer->byte_at_a_time)
+			break;
+		for (run = (const unsigned char *)lexer->source->data + lexer->source->position,
+			 run_end = (const unsigned char *)lexer->source->data + lexer->source->length; run < run_end && char_lead_class[*run] == LEAD_OTHER; run++)
+			;
+		append_run(lexer, (const char *)run);
 		break;
 	}
 	return NULL;
@@ -366,210 +621,147 @@ parser_token_t *handle_idle_state(FILE *input_stream, int current_char)
 /* ********************************************************************************************************************** */
 /* ********************************************************************************************************************** */
 
-parser_token_t *handle_preprocessor_state(FILE *input_stream, int current_char)
+parser_token_t *handle_preprocessor_state(s2html_lexer_t *lexer, int current_char)
 {
-	switch (preprocessor_substate)
+	switch (lexer->preprocessor_substate)
 	{
 	case PARSE_STATE_SUB_PREPROCESSOR_MAIN:
-		return handle_preprocessor_main_state(input_stream, current_char);
+		return handle_preprocessor_main_state(lexer, current_char);
 	case PARSE_STATE_SUB_PREPROCESSOR_RESERVE_KEYWORD:
-		return handle_keyword_state(input_stream, current_char);
+		return handle_keyword_state(lexer, current_char);
 	case PARSE_STATE_SUB_PREPROCESSOR_ASCII_CHAR:
-		return handle_ascii_state(input_stream, current_char);
+		return handle_ascii_state(lexer, current_char);
 	default:
+#ifdef DEBUG
 		printf("ERROR: Invalid preprocessor substate\n");
-		current_state = PARSE_STATE_IDLE;
+#endif
+		lexer->current_state = PARSE_STATE_IDLE;
 	}
 	return NULL;
 }
 
-parser_token_t *handle_preprocessor_main_state(FILE *input_stream, int current_char)
+parser_token_t *handle_preprocessor_main_state(s2html_lexer_t *lexer, int current_char)
 {
-	static int space_encountered = 1;
 	switch (current_char)
 	{
 	case ' ': /* Space in preprocessor directive */
-		space_encountered = 0;
-		current_token.content[token_buffer_index++] = current_char;
+		lexer->space_encountered = 0;
+		append_token_chars(lexer, 1);
 		break;
 	case '<': /* System header file start */
-		space_encountered = 1;
-		finalize_token(PARSE_STATE_HEADER_FILE, TOKEN_PREPROCESSOR_DIRECTIVE);
-		return &current_token;
+		lexer->space_encountered = 1;
+		finalize_token(lexer, PARSE_STATE_HEADER_FILE, TOKEN_PREPROCESSOR_DIRECTIVE);
+		return &lexer->current_token;
 		break;
 	case '"': /* User-defined header file start */
-		space_encountered = 1;
-		fseek(input_stream, -1L, SEEK_CUR);
-		finalize_token(PARSE_STATE_HEADER_FILE, TOKEN_PREPROCESSOR_DIRECTIVE);
-		current_token.attribute = USER_DEFINED_HEADER;
-		return &current_token;
+		lexer->space_encountered = 1;
+		rewind_source(lexer, 1);
+		finalize_token(lexer, PARSE_STATE_HEADER_FILE, TOKEN_PREPROCESSOR_DIRECTIVE);
+		lexer->current_token.attribute = USER_DEFINED_HEADER;
+		return &lexer->current_token;
 		break;
 	case '\n': /* End of preprocessor directive */
-		finalize_token(PARSE_STATE_IDLE, TOKEN_PREPROCESSOR_DIRECTIVE);
-		current_token.attribute = USER_DEFINED_HEADER;
-		return &current_token;
+		finalize_token(lexer, PARSE_STATE_IDLE, TOKEN_PREPROCESSOR_DIRECTIVE);
+		lexer->current_token.attribute = USER_DEFINED_HEADER;
+		return &lexer->current_token;
 		break;
-	case 'a' ... 'z': /* Macro or directive name */
-	case 'A' ... 'Z':
-		if (space_encountered)
+	default:
+		if ((char_flags[current_char] & CHAR_LETTER) && !lexer->space_encountered) /* Macro name after the directive */
 		{
-			current_token.content[token_buffer_index++] = current_char;
-			return NULL;
+			lexer->space_encountered = 1;
+			rewind_source(lexer, 1);
+			finalize_token(lexer, PARSE_STATE_IDLE, TOKEN_PREPROCESSOR_DIRECTIVE);
+			return &lexer->current_token;
 		}
-		space_encountered = 1;
-		fseek(input_stream, -1L, SEEK_CUR);
-		finalize_token(PARSE_STATE_IDLE, TOKEN_PREPROCESSOR_DIRECTIVE);
-		return &current_token;
-		break;
-	default:
-		current_token.content[token_buffer_index++] = current_char;
+		append_token_chars(lexer, 1);
 		break;
 	}
 	return NULL;
 }
 
-parser_token_t *handle_header_state(FILE *input_stream, int current_char)
+parser_token_t *handle_header_state(s2html_lexer_t *lexer, int current_char)
 {
 	switch (current_char)
 	{
 	case '>': /* System header file end */
-		finalize_token(PARSE_STATE_IDLE, TOKEN_HEADER_FILE);
-		return &current_token;
+		finalize_token(lexer, PARSE_STATE_IDLE, TOKEN_HEADER_FILE);
+		return &lexer->current_token;
 		break;
 	case '"': /* User header file handling */
-		if (token_buffer_index == 0)
+		if (lexer->token_buffer_index == 0)
 		{
-			current_token.content[token_buffer_index++] = current_char;
+			append_token_chars(lexer, 1);
 			break;
 		}
-		current_token.content[token_buffer_index++] = current_char;
-		finalize_token(PARSE_STATE_IDLE, TOKEN_HEADER_FILE);
-		current_token.attribute = USER_DEFINED_HEADER;
-		return &current_token;
+		append_token_chars(lexer, 1);
+		finalize_token(lexer, PARSE_STATE_IDLE, TOKEN_HEADER_FILE);
+		lexer->current_token.attribute = USER_DEFINED_HEADER;
+		return &lexer->current_token;
 		break;
 	default: /* Accumulate header file name */
-		current_token.content[token_buffer_index++] = current_char;
+		append_token_chars(lexer, 1);
 		break;
 	}
 	return NULL;
 }
 
-parser_token_t *handle_keyword_state(FILE *input_stream, int current_char)
+parser_token_t *handle_keyword_state(s2html_lexer_t *lexer, int current_char)
 {
-	/* Handle operators within keywords */
-	if (is_operator_char(current_char))
-	{
-		fseek(input_stream, -1L, SEEK_CUR);
-		finalize_token(PARSE_STATE_OPERATORS, TOKEN_RESERVE_KEYWORD);
-		int keyword_classification = classify_keyword(current_token.content);
-		if (keyword_classification == DATATYPE_KEYWORD)
-			current_token.attribute = DATATYPE_KEYWORD;
-		else if (keyword_classification == CONTROL_KEYWORD)
-			current_token.attribute = CONTROL_KEYWORD;
-		else
-			current_token.type = TOKEN_REGULAR_TEXT;
-		return &current_token;
-	}
+	unsigned char flags = char_flags[current_char];
 
-	/* Handle symbols within keywords */
-	if (is_delimiter_char(current_char))
+	if (!(flags & CHAR_ENDS_KEYWORD)) /* Accumulate the rest of the identifier in one go */
 	{
-		fseek(input_stream, -1L, SEEK_CUR);
-		finalize_token(PARSE_STATE_SYMBOLS, TOKEN_RESERVE_KEYWORD);
-		int keyword_classification = classify_keyword(current_token.content);
-		if (keyword_classification == DATATYPE_KEYWORD)
-			current_token.attribute = DATATYPE_KEYWORD;
-		else if (keyword_classification == CONTROL_KEYWORD)
-			current_token.attribute = CONTROL_KEYWORD;
-		else
-			current_token.type = TOKEN_REGULAR_TEXT;
-		return &current_token;
+		append_token_chars(lexer, 1);
+		accumulate_until(lexer, CHAR_ENDS_KEYWORD);
+		return NULL;
 	}
 
-	switch (current_char)
-	{
-	case '(':
-	case ')':
-	case '[':
-	case ' ': /* Keyword termination characters */
-	case '\n':
-	case '\t':
-	case ';':
-		fseek(input_stream, -1L, SEEK_CUR);
-		finalize_token(PARSE_STATE_IDLE, TOKEN_RESERVE_KEYWORD);
-		int keyword_classification = classify_keyword(current_token.content);
-		if (keyword_classification == DATATYPE_KEYWORD)
-			current_token.attribute = DATATYPE_KEYWORD;
-		else if (keyword_classification == CONTROL_KEYWORD)
-			current_token.attribute = CONTROL_KEYWORD;
-		else
-			current_token.type = TOKEN_REGULAR_TEXT;
-		return &current_token;
-		break;
-	case '0' ... '9': /* Number within identifier */
-		fseek(input_stream, -1L, SEEK_CUR);
-		finalize_token(PARSE_STATE_NUMERIC_CONSTANT, TOKEN_RESERVE_KEYWORD);
-		int keyword_type = classify_keyword(current_token.content);
-		if (keyword_type == DATATYPE_KEYWORD)
-			current_token.attribute = DATATYPE_KEYWORD;
-		else if (keyword_type == CONTROL_KEYWORD)
-			current_token.attribute = CONTROL_KEYWORD;
-		else
-			current_token.type = TOKEN_REGULAR_TEXT;
-		return &current_token;
-		break;
-	default:
-		current_token.content[token_buffer_index++] = current_char;
-		break;
-	}
-	return NULL;
+	if (flags & CHAR_OPERATOR) /* Handle operators within keywords */
+		return finalize_keyword_token(lexer, PARSE_STATE_OPERATORS);
+	if (flags & CHAR_DELIMITER) /* Handle symbols within keywords */
+		return finalize_keyword_token(lexer, PARSE_STATE_SYMBOLS);
+	if (flags & CHAR_DIGIT) /* Number within identifier */
+		return finalize_keyword_token(lexer, PARSE_STATE_NUMERIC_CONSTANT);
+	return finalize_keyword_token(lexer, PARSE_STATE_IDLE); /* Keyword termination characters */
 }
 
-parser_token_t *handle_number_state(FILE *input_stream, int current_char)
+parser_token_t *handle_number_state(s2html_lexer_t *lexer, int current_char)
 {
-	switch (current_char)
+	if (char_flags[current_char] & CHAR_ENDS_NUMBER) /* Numeric constant termination */
 	{
-	case '\n':
-	case ' ':
-	case '\t':
-	case ';':
-	case ')':
-	case '}':
-	case ']':
-	case ',': /* Numeric constant termination */
-		fseek(input_stream, -1L, SEEK_CUR);
-		finalize_token(PARSE_STATE_IDLE, TOKEN_NUMERIC_CONSTANT);
-		return &current_token;
-	default: /* Continue accumulating digits */
-		current_token.content[token_buffer_index++] = current_char;
-		break;
+		rewind_source(lexer, 1);
+		finalize_token(lexer, PARSE_STATE_IDLE, TOKEN_NUMERIC_CONSTANT);
+		return &lexer->current_token;
 	}
+
+	/* Continue accumulating digits */
+	append_token_chars(lexer, 1);
+	accumulate_until(lexer, CHAR_ENDS_NUMBER);
 	return NULL;
 }
 
-parser_token_t *handle_string_state(FILE *input_stream, int current_char)
+parser_token_t *handle_string_state(s2html_lexer_t *lexer, int current_char)
 {
 	switch (current_char)
 	{
 	case '\"': /* String literal end */
-		current_token.content[token_buffer_index++] = current_char;
-		finalize_token(PARSE_STATE_IDLE, TOKEN_STRING_LITERAL);
-		return &current_token;
+		append_token_chars(lexer, 1);
+		finalize_token(lexer, PARSE_STATE_IDLE, TOKEN_STRING_LITERAL);
+		return &lexer->current_token;
 		break;
 	case '%': /* Format specifier detection */
-		fseek(input_stream, -1L, SEEK_CUR);
-		finalize_token(PARSE_STATE_FORMAT_SPECIFIER, TOKEN_STRING_LITERAL);
-		return &current_token;
-	default: /* Accumulate string content */
-		current_token.content[token_buffer_index++] = current_char;
+		rewind_source(lexer, 1);
+		finalize_token(lexer, PARSE_STATE_FORMAT_SPECIFIER, TOKEN_STRING_LITERAL);
+		return &lexer->current_token;
+	default: /* Accumulate string content up to the closing quote or the next format specifier */
+		append_token_chars(lexer, 1);
+		append_until_byte(lexer, '\"', '%');
 		return NULL;
 		break;
 	}
 }
 
-/**** End of file ****/
-
-parser_token_t *handle_single_comment_state(FILE *input_stream, int current_char)
+parser_token_t *handle_single_comment_state(s2html_lexer_t *lexer, int current_char)
 {
 	switch (current_char)
 	{
@@ -577,136 +769,143 @@ parser_token_t *handle_single_comment_state(FILE *input_stream, int current_char
 #ifdef DEBUG
 		printf("\nSingle line comment end\n");
 #endif
-		current_token.content[token_buffer_index++] = current_char;
-		finalize_token(PARSE_STATE_IDLE, TOKEN_SINGLE_LINE_COMMENT);
-		return &current_token;
-	default: /* Accumulate comment text */
-		current_token.content[token_buffer_index++] = current_char;
+		append_token_chars(lexer, 1);
+		finalize_token(lexer, PARSE_STATE_IDLE, TOKEN_SINGLE_LINE_COMMENT);
+		return &lexer->current_token;
+	default: /* Accumulate comment text up to the newline */
+		append_token_chars(lexer, 1);
+		append_until_byte(lexer, '\n', SOURCE_EOF);
 		break;
 	}
 	return NULL;
 }
 
-parser_token_t *handle_multi_comment_state(FILE *input_stream, int current_char)
+parser_token_t *handle_multi_comment_state(s2html_lexer_t *lexer, int current_char)
 {
 	int previous_char;
 	switch (current_char)
 	{
 	case '*': /* Potential comment end */
 		previous_char = current_char;
-		current_token.content[token_buffer_index++] = current_char;
-		if ((current_char = fgetc(input_stream)) == '/')
+		append_token_chars(lexer, 1);
+		if ((current_char = source_next_char(lexer->source)) == '/')
 		{
 #ifdef DEBUG
 			printf("\nMulti line comment End : */\n");
 #endif
 			previous_char = current_char;
-			current_token.content[token_buffer_index++] = current_char;
-			finalize_token(PARSE_STATE_IDLE, TOKEN_MULTI_LINE_COMMENT);
-			return &current_token;
+			append_token_chars(lexer, 1);
+			finalize_token(lexer, PARSE_STATE_IDLE, TOKEN_MULTI_LINE_COMMENT);
+			return &lexer->current_token;
 		}
-		else /* Comment continues */
+		else if (current_char != SOURCE_EOF) /* Comment continues */
 		{
-			current_token.content[token_buffer_index++] = current_char;
+			append_token_chars(lexer, 1);
+		}
+		else
+		{
+			rewind_source(lexer, 1);
 		}
 		break;
-	case '/':								 /* Check for comment end pattern */
-		fseek(input_stream, -2L, SEEK_CUR);	 /* Look back two positions */
-		previous_char = fgetc(input_stream); /* Read previous character */
-		fgetc(input_stream);				 /* Return to current position */
+	case '/':									/* Check for comment end pattern */
+		previous_char = source_look_back(lexer->source, 2); /* Byte before the '/' */
 
-		current_token.content[token_buffer_index++] = current_char;
+		append_token_chars(lexer, 1);
 		if (previous_char == '*') /* Comment actually ends */
 		{
-			finalize_token(PARSE_STATE_IDLE, TOKEN_MULTI_LINE_COMMENT);
-			return &current_token;
+			finalize_token(lexer, PARSE_STATE_IDLE, TOKEN_MULTI_LINE_COMMENT);
+			return &lexer->current_token;
 		}
+		append_until_byte(lexer, '*', SOURCE_EOF);
 		break;
-	default: /* Accumulate comment content */
-		current_token.content[token_buffer_index++] = current_char;
+	default: /* Accumulate comment content up to the next '*': a '/' before it follows some other byte, so cannot end the comment */
+		append_token_chars(lexer, 1);
+		append_until_byte(lexer, '*', SOURCE_EOF);
 		break;
 	}
 	return NULL;
 }
 
-parser_token_t *handle_ascii_state(FILE *input_stream, int current_char)
+parser_token_t *handle_ascii_state(s2html_lexer_t *lexer, int current_char)
 {
 	char next_char;
 	if (current_char == '\'') /* Potential ASCII char end */
 	{
-		if ((next_char = fgetc(input_stream)) == '\'') /* Handle consecutive quotes (empty char or adjacent char literals) - eg: '', ''', 'a''a', 'a'' */
+		if ((next_char = source_next_char(lexer->source)) == '\'') /* Handle consecutive quotes (empty char or adjacent char literals) - eg: '', ''', 'a''a', 'a'' */
 		{
-			current_token.content[token_buffer_index++] = next_char;
+			append_token_chars(lexer, 2);
 		}
 		else
 		{
-			fseek(input_stream, -1L, SEEK_CUR); /* Rewind if not closing quote */
+			rewind_source(lexer, 1); /* Rewind if not closing quote */
+			append_token_chars(lexer, 1);
 		}
-		current_token.content[token_buffer_index++] = current_char;
-		finalize_token(PARSE_STATE_IDLE, TOKEN_ASCII_CHAR);
-		return &current_token;
+		finalize_token(lexer, PARSE_STATE_IDLE, TOKEN_ASCII_CHAR);
+		return &lexer->current_token;
 	}
-	current_token.content[token_buffer_index++] = current_char; /* Accumulate character content */
+	append_token_chars(lexer, 1); /* Accumulate character content */
 	return NULL;
 }
 
-parser_token_t *handle_format_specifier_state(FILE *input_stream, int current_char)
+parser_token_t *handle_format_specifier_state(s2html_lexer_t *lexer, int current_char)
 {
-	char next_char;
-	switch (current_char)
+	int next_char;
+
+	if (char_flags[current_char] & CHAR_ENDS_FORMAT) /* Format specifier termination */
+	{
+		rewind_source(lexer, 1);
+		finalize_token(lexer, PARSE_STATE_STRING, TOKEN_FORMAT_SPECIFIER);
+		return &lexer->current_token;
+	}
+
+	if (current_char == '.') /* Precision specifier (e.g., %.2f) */
 	{
-	case ' ':
-	case '"':
-	case '\\': /* Format specifier termination */
-		fseek(input_stream, -1L, SEEK_CUR);
-		finalize_token(PARSE_STATE_STRING, TOKEN_FORMAT_SPECIFIER);
-		return &current_token;
-	case '.': /* Precision specifier (e.g., %.2f) */
-		next_char = fgetc(input_stream);
-		if (next_char >= '0' && next_char <= '9')
+		next_char = source_next_char(lexer->source);
+		if (next_char != SOURCE_EOF && (char_flags[next_char] & CHAR_DIGIT))
 		{
-			current_token.content[token_buffer_index++] = current_char;
-			current_token.content[token_buffer_index++] = next_char;
+			append_token_chars(lexer, 2);
 			return NULL;
 		}
-		else
-		{
-			fseek(input_stream, -2L, SEEK_CUR);
-			finalize_token(PARSE_STATE_STRING, TOKEN_FORMAT_SPECIFIER);
-			return &current_token;
-		}
-	default: /* Accumulate format specifier */
-		current_token.content[token_buffer_index++] = current_char;
-		return NULL;
+		rewind_source(lexer, 2);
+		finalize_token(lexer, PARSE_STATE_STRING, TOKEN_FORMAT_SPECIFIER);
+		return &lexer->current_token;
 	}
+
+	/* Accumulate format specifier */
+	append_token_chars(lexer, 1);
+	return NULL;
 }
 
-parser_token_t *handle_operator_state(FILE *input_stream, int current_char)
+parser_token_t *handle_operator_state(s2html_lexer_t *lexer, int current_char)
 {
 	if (is_operator_char(current_char)) /* Continue operator sequence */
 	{
-		current_token.content[token_buffer_index++] = current_char;
+		append_token_chars(lexer, 1);
+		accumulate_while(lexer, CHAR_OPERATOR);
 		return NULL;
 	}
 	else /* End of operator sequence */
 	{
-		fseek(input_stream, -1L, SEEK_CUR);
-		finalize_token(PARSE_STATE_IDLE, TOKEN_OPERATORS);
-		return &current_token;
+		rewind_source(lexer, 1);
+		finalize_token(lexer, PARSE_STATE_IDLE, TOKEN_OPERATORS);
+		return &lexer->current_token;
 	}
 }
 
-parser_token_t *handle_symbol_state(FILE *input_stream, int current_char)
+parser_token_t *handle_symbol_state(s2html_lexer_t *lexer, int current_char)
 {
 	if (is_delimiter_char(current_char)) /* Continue symbol sequence */
 	{
-		current_token.content[token_buffer_index++] = current_char;
+		append_token_chars(lexer, 1);
+		accumulate_while(lexer, CHAR_DELIMITER);
 		return NULL;
 	}
 	else /* End of symbol sequence */
 	{
-		fseek(input_stream, -1L, SEEK_CUR);
-		finalize_token(PARSE_STATE_IDLE, TOKEN_SYMBOL);
-		return &current_token;
+		rewind_source(lexer, 1);
+		finalize_token(lexer, PARSE_STATE_IDLE, TOKEN_SYMBOL);
+		return &lexer->current_token;
 	}
-}
\ No newline at end of file
+}
+
+/**** End of file ****/
@@ -1,13 +1,15 @@
 #ifndef S2HTML_EVENT_H
 #define S2HTML_EVENT_H
 
+#include "s2html_input.h"
+
 /* Token property definitions */
 #define USER_DEFINED_HEADER		1
 #define SYSTEM_HEADER_FILE		2
 #define DATATYPE_KEYWORD		3
 #define CONTROL_KEYWORD			4
 
-#define MAX_TOKEN_LENGTH		1024
+#define LEXER_CONTEXT_BYTES		2		/* bytes on either side of a token boundary the lexer may read when crossing it */
 
 typedef enum
 {
@@ -27,34 +29,101 @@ typedef enum
 	TOKEN_END_OF_FILE
 }token_type_t;
 
+/* Token bytes are always contiguous in the source, so a token is a view: valid until the next extract_next_token */
 typedef struct
 {
 	token_type_t type;				// token classification
 	int attribute;					// additional token properties
-	int size;						// length of token data
-	char content[MAX_TOKEN_LENGTH];	// actual token string
+	size_t size;					// length of token data
+	const char *content;			// token bytes in the source buffer, not NUL terminated
 }parser_token_t;
 
+/********** Parser state definitions **********/
+typedef enum
+{
+	PARSE_STATE_IDLE,
+	PARSE_STATE_PREPROCESSOR_DIRECTIVE,
+	PARSE_STATE_SUB_PREPROCESSOR_MAIN,
+	PARSE_STATE_SUB_PREPROCESSOR_RESERVE_KEYWORD,
+	PARSE_STATE_SUB_PREPROCESSOR_ASCII_CHAR,
+	PARSE_STATE_HEADER_FILE,
+	PARSE_STATE_RESERVE_KEYWORD,
+	PARSE_STATE_NUMERIC_CONSTANT,
+	PARSE_STATE_STRING,
+	PARSE_STATE_SINGLE_LINE_COMMENT,
+	PARSE_STATE_MULTI_LINE_COMMENT,
+	PARSE_STATE_FORMAT_SPECIFIER,
+	PARSE_STATE_OPERATORS,
+	PARSE_STATE_SYMBOLS,
+	PARSE_STATE_ASCII_CHAR
+} parser_state_t;
+
+/* Lexer context: everything one conversion needs, so conversions can run side by side */
+typedef struct
+{
+	source_buffer_t *source;				// input being tokenized
+	parser_state_t current_state;			// current parser state
+	parser_state_t preprocessor_substate;	// sub-state for preprocessor parsing
+	int space_encountered;					// preprocessor: 0 once a space followed the directive name
+	size_t token_buffer_index;				// bytes accumulated in current_token, from source->pinned on
+	parser_token_t current_token;			// last token returned, overwritten by each extract_next_token
+	struct s2html_stats *stats;				// NULL => not counted; only S2HTML_STATS builds count anything
+	int table_driven;						// non-zero => tokens come from extract_next_token_dfa, not the handlers
+	int byte_at_a_time;						// non-zero => body and text runs go through their handler a byte per call
+	unsigned int dfa_state;					// table_driven only: offset of the transition table row the next token starts in
+}s2html_lexer_t;
+
+/* Lexer state between two tokens: resuming from it continues exactly as the lexer that saved it would */
+typedef struct
+{
+	size_t position;						// source offset of the next unread byte
+	parser_state_t current_state;			// state the next token starts in
+	int attribute;							// carried over, the next token may not overwrite it
+	int space_encountered;					// preprocessor directive name tracking
+}lexer_checkpoint_t;
+
+/* Struct-of-arrays token list of a whole source buffer: lexing and emitting can run as separate passes */
+typedef struct
+{
+	unsigned char *types;					// token_type_t of each token
+	unsigned char *attributes;				// attribute each token was returned with
+	size_t *offsets;						// first byte of each token in the source buffer
+	size_t *lengths;						// bytes in each token
+	size_t count;							// tokens stored, the last is TOKEN_END_OF_FILE
+	size_t capacity;						// tokens the arrays can hold
+	struct s2html_arena *arena;				// non-NULL => the arrays are cut from this arena and released by its reset
+}token_table_t;
+
 /********** function prototypes **********/
 
-parser_token_t *extract_next_token(FILE *input_stream);
+void init_lexer(s2html_lexer_t *lexer, source_buffer_t *source);
+parser_token_t *extract_next_token(s2html_lexer_t *lexer);
+void save_lexer_checkpoint(const s2html_lexer_t *lexer, lexer_checkpoint_t *checkpoint);
+void restore_lexer_checkpoint(s2html_lexer_t *lexer, const lexer_checkpoint_t *checkpoint);
+int lexer_checkpoints_equal(const lexer_checkpoint_t *first, const lexer_checkpoint_t *second);
+int init_token_table(token_table_t *table, size_t expected_count);
+int init_arena_token_table(token_table_t *table, size_t expected_count, struct s2html_arena *arena);
+void free_token_table(token_table_t *table);
+int lex_source_to_table(source_buffer_t *source, token_table_t *table);
+parser_token_t *extract_next_token_dfa(s2html_lexer_t *lexer);
 
 /********** state handlers **********/
-parser_token_t * handle_idle_state(FILE *input_stream, int current_char);
-parser_token_t * handle_single_comment_state(FILE *input_stream, int current_char);
-parser_token_t * handle_multi_comment_state(FILE *input_stream, int current_char);
-parser_token_t * handle_number_state(FILE *input_stream, int current_char);
-parser_token_t * handle_string_state(FILE *input_stream, int current_char);
-parser_token_t * handle_header_state(FILE *input_stream, int current_char);
-parser_token_t * handle_ascii_state(FILE *input_stream, int current_char);
-parser_token_t * handle_keyword_state(FILE *input_stream, int current_char);
-parser_token_t * handle_preprocessor_state(FILE *input_stream, int current_char);
-parser_token_t * handle_preprocessor_main_state(FILE *input_stream, int current_char);
-parser_token_t * handle_format_specifier_state(FILE *input_stream, int current_char);
-parser_token_t * handle_operator_state(FILE *input_stream, int current_char);
-parser_token_t * handle_symbol_state(FILE *input_stream, int current_char);
+parser_token_t * handle_idle_state(s2html_lexer_t *lexer, int current_char);
+parser_token_t * handle_single_comment_state(s2html_lexer_t *lexer, int current_char);
+parser_token_t * handle_multi_comment_state(s2html_lexer_t *lexer, int current_char);
+parser_token_t * handle_number_state(s2html_lexer_t *lexer, int current_char);
+parser_token_t * handle_string_state(s2html_lexer_t *lexer, int current_char);
+parser_token_t * handle_header_state(s2html_lexer_t *lexer, int current_char);
+parser_token_t * handle_ascii_state(s2html_lexer_t *lexer, int current_char);
+parser_token_t * handle_keyword_state(s2html_lexer_t *lexer, int current_char);
+parser_token_t * handle_preprocessor_state(s2html_lexer_t *lexer, int current_char);
+parser_token_t * handle_preprocessor_main_state(s2html_lexer_t *lexer, int current_char);
+parser_token_t * handle_format_specifier_state(s2html_lexer_t *lexer, int current_char);
+parser_token_t * handle_operator_state(s2html_lexer_t *lexer, int current_char);
+parser_token_t * handle_symbol_state(s2html_lexer_t *lexer, int current_char);
 
 /********** Utility functions **********/
+int classify_keyword(const char *word_to_check, size_t length);
 
 #endif
 /**** End of file ****/
\ No newline at end of file
@@ -0,0 +1,518 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "s2html_event.h"
+#include "s2html_conv.h"
+#include "s2html_parallel.h"
+#include "s2html_lineindex.h"
+#include "s2html_arena.h"
+
+#define DIFF_CONTEXT_BYTES		40		/* HTML shown on each side of the first difference */
+#define DEFAULT_RANDOM_SEED		1
+#define RANDOM_INPUT_PIECES		24		/* adversarial pieces and random bytes concatenated per random input */
+#define PARALLEL_TEST_THREADS	4
+#define GOLDEN_PATH_LENGTH		4096
+#define GOLDEN_ADVERSARIAL_NAME	"adversarial"	/* golden file of the built-in inputs */
+#define FUZZ_ARENA_BLOCK_SIZE	256		/* tiny blocks, so arena allocations keep moving to new blocks */
+
+/*
+ * Differential harness: every engine must produce exactly the HTML of the reference conversion (source in memory,
+ * one lexer, tokens emitted as they are lexed), in every combination of line numbers, embedded theme and compact markup.
+ * The line_index engine also checks that every indexed line starts after a newline of the HTML and of the source.
+ * The reference itself runs the SIMD escape scan and the lexer's memchr runs, so the scalar_escape and byte_at_a_time
+ * engines turn those off, and --golden compares it with HTML committed in golden/, written by the original converter.
+ *
+ * Build it with small windows and chunks so the stream refill and the parallel joins run on small inputs too:
+ *   -DSOURCE_WINDOW_SIZE=40 -DPARALLEL_MIN_CHUNK_SIZE=64 -DPARALLEL_RESYNC_WINDOW=32
+ * Add -DS2HTML_LIBFUZZER -fsanitize=fuzzer to get only the libFuzzer entry point.
+ */
+
+/* Converts size bytes of data into output, a memory buffer; returns 0 if the engine cannot run on this input */
+typedef int (*conversion_engine_fn)(const char *data, size_t size, int options, output_buffer_t *output);
+
+/********** Helper function implementations **********/
+
+static int convert_with_reference(const char *data, size_t size, int options, output_buffer_t *output)
+{
+	source_buffer_t source;
+
+	open_source_memory(&source, data, size);
+	convert_source_to_html(&source, output, options);
+	return 1;
+}
+
+/* Lexes into a token table, then emits it; the table and the body are cut from arena when it is not NULL */
+static int convert_through_table(const char *data, size_t size, int options, output_buffer_t *output, arena_t *arena)
+{
+	source_buffer_t source;
+	token_table_t table;
+	s2html_emitter_t emitter;
+	output_buffer_t body;
+	int status;
+
+	if (arena ? !init_arena_token_table(&table, size / 64, arena) : !init_token_table(&table, size / 4))
+		return 0;
+	open_source_memory(&source, data, size);
+	if ((status = lex_source_to_table(&source, &table)))
+	{
+		/* The theme is chosen from the classes of the body, collected here the way the parallel engine does */
+		init_emitter(&emitter, output, options);
+		if (emitter.embed_css && (status = arena ? open_arena_output_buffer(&body, NULL, arena) : open_memory_output_buffer(&body)))
+		{
+			emitter.output = &body;
+			emit_token_table(&emitter, &table, data);
+			emitter.output = output;
+			emitter.used_classes = collect_style_classes(body.data, body.length, emitter.compact);
+			generate_html_header(&emitter, HTML_DOCUMENT_START);
+			output_append(output, body.data, body.length);
+			close_output_buffer(&body);
+		}
+		else if (!emitter.embed_css)
+		{
+			generate_html_header(&emitter, HTML_DOCUMENT_START);
+			emit_token_table(&emitter, &table, data);
+		}
+		generate_html_footer(&emitter, HTML_DOCUMENT_END);
+	}
+	free_token_table(&table);
+	return status;
+}
+
+/* Token table API: the whole source is lexed first, then emitted */
+static int convert_with_token_table(const char *data, size_t size, int options, output_buffer_t *output)
+{
+	return convert_through_table(data, size, options, output, NULL);
+}
+
+/* Token table, body and HTML in one arena reused by every input: the arrays outgrow their blocks and are copied, and
+   nothing of the previous input may show through after the reset */
+static int convert_with_arena(const char *data, size_t size, int options, output_buffer_t *output)
+{
+	static arena_t arena;
+	output_buffer_t html;
+	int status;
+
+	if (arena.block_size == 0)
+		init_arena(&arena, FUZZ_ARENA_BLOCK_SIZE);
+	arena_reset(&arena);
+	if (!open_arena_output_buffer(&html, NULL, &arena))
+		return 0;
+	if ((status = convert_through_table(data, size, options, &html, &arena)))
+		output_append(output, html.data, html.length);
+	if (html.error)
+		output->error = 1;
+	close_output_buffer(&html);
+	return status;
+}
+
+/* Stream input: the source arrives through the sliding window */
+static int convert_with_stream(const char *data, size_t size, int options, output_buffer_t *output)
+{
+	source_buffer_t source;
+	FILE *stream;
+
+	if (size == 0 || NULL == (stream = fmemopen((void *)data, size, "r")))
+		return 0;
+	if (!open_source_stream(&source, stream))
+	{
+		fclose(stream);
+		return 0;
+	}
+	convert_source_to_html(&source, output, options);
+	close_source_buffer(&source);
+	fclose(stream);
+	return 1;
+}
+
+/* Returns 1 if index describes output and the size bytes at data: ascending positions, each line after a newline */
+static int line_index_matches(const line_index_t *index, const char *data, size_t size, const output_buffer_t *output)
+{
+	unsigned long long html, previous_html = 0, previous_source = 0;
+	size_t i;
+
+	if (index->failed || index->count == 0 || index->source_offsets[0] != 0 || index->source_offsets[index->count - 1] != size)
+		return 0;
+	for (i = 0; i < index->count; i++)
+	{
+		html = index->html_base + index->html_offsets[i];
+		if (html > output->length || html < previous_html || index->source_offsets[i] < previous_source)
+			return 0;
+		if (i > 0 && i < index->count - 1 && (output->data[html - 1] != '\n' || data[index->source_offsets[i] - 1] != '\n'))
+			return 0;
+		previous_html = html;
+		previous_source = index->source_offsets[i];
+	}
+	return 1;
+}
+
+/* Stream input with a line index; an index that does not match the document empties the output so it is reported */
+static int convert_with_line_index(const char *data, size_t size, int options, output_buffer_t *output)
+{
+	source_buffer_t source;
+	line_index_t index;
+	FILE *stream;
+
+	if (size == 0 || NULL == (stream = fmemopen((void *)data, size, "r")))
+		return 0;
+	if (!open_source_stream(&source, stream))
+	{
+		fclose(stream);
+		return 0;
+	}
+	init_line_index(&index);
+	convert_source_to_html_indexed(&source, output, options, &index);
+	if (!line_index_matches(&index, data, size, output))
+	{
+		fprintf(stderr, "line index does not match the document\n");
+		output->length = 0;
+	}
+	free_line_index(&index);
+	close_source_buffer(&source);
+	fclose(stream);
+	return 1;
+}
+
+/* Parallel lexer: chunks are lexed from guessed states and joined */
+static int convert_with_parallel(const char *data, size_t size, int options, output_buffer_t *output)
+{
+	source_buffer_t source;
+	parallel_result_t result;
+
+	open_source_memory(&source, data, size);
+	convert_source_parallel(&source, output, options, PARALLEL_TEST_THREADS, &result);
+	return 1;
+}
+
+/* Table driven lexer generated from s2html_lexer.def, source in memory */
+static int convert_with_dfa(const char *data, size_t size, int options, output_buffer_t *output)
+{
+	return convert_with_reference(data, size, options | CONVERT_DFA_LEXER, output);
+}
+
+/* Table driven lexer over the sliding window, so its refills run too */
+static int convert_with_dfa_stream(const char *data, size_t size, int options, output_buffer_t *output)
+{
+	return convert_with_stream(data, size, options | CONVERT_DFA_LEXER, output);
+}
+
+/* Clean runs found by escape_scan_scalar instead of the SIMD kernel */
+static int convert_with_scalar_escape(const char *data, size_t size, int options, output_buffer_t *output)
+{
+	return convert_with_reference(data, size, options | CONVERT_SCALAR_ESCAPE, output);
+}
+
+/* Comment, string and text bodies through their state handler one byte per call, no memchr or run scans */
+static int convert_with_byte_at_a_time(const char *data, size_t size, int options, output_buffer_t *output)
+{
+	return convert_with_reference(data, size, options | CONVERT_BYTE_AT_A_TIME, output);
+}
+
+/* Both slow paths over the sliding window */
+static int convert_with_slow_stream(const char *data, size_t size, int options, output_buffer_t *output)
+{
+	return convert_with_stream(data, size, options | CONVERT_SCALAR_ESCAPE | CONVERT_BYTE_AT_A_TIME, output);
+}
+
+static const struct
+{
+	const char *name;
+	conversion_engine_fn convert;
+} engines[] = {
+	{"token_table", convert_with_token_table},
+	{"arena", convert_with_arena},
+	{"stream", convert_with_stream},
+	{"parallel", convert_with_parallel},
+	{"line_index", convert_with_line_index},
+	{"dfa", convert_with_dfa},
+	{"dfa_stream", convert_with_dfa_stream},
+	{"scalar_escape", convert_with_scalar_escape},
+	{"byte_at_a_time", convert_with_byte_at_a_time},
+	{"slow_stream", convert_with_slow_stream},
+};
+
+/* Prints where two HTML documents first differ */
+static void report_difference(const char *input_name, const char *engine_name, int options,
+							  const output_buffer_t *expected, const output_buffer_t *actual)
+{
+	size_t offset = 0, shortest = expected->length < actual->length ? expected->length : actual->length, from;
+
+	while (offset < shortest && expected->data[offset] == actual->data[offset])
+		offset++;
+	from = offset > DIFF_CONTEXT_BYTES ? offset - DIFF_CONTEXT_BYTES : 0;
+	fprintf(stderr, "MISMATCH %s: engine %s%s%s%s differs at HTML byte %zu (lengths %zu / %zu)\n", input_name, engine_name,
+			options & CONVERT_LINE_NUMBERS ? " -n" : "", options & CONVERT_EMBED_CSS ? " --embed-css" : "", options & CONVERT_COMPACT ? " --compact" : "", offset, expected->length, actual->length);
+	fprintf(stderr, "  expected: %.*s\n", (int)((expected->length - from < 2 * DIFF_CONTEXT_BYTES) ? expected->length - from : 2 * DIFF_CONTEXT_BYTES), expected->data + from);
+	fprintf(stderr, "  actual:   %.*s\n", (int)((actual->length - from < 2 * DIFF_CONTEXT_BYTES) ? actual->length - from : 2 * DIFF_CONTEXT_BYTES), actual->data + from);
+}
+
+/* Runs every engine over one input and compares it with the reference; returns the number of mismatches */
+static int compare_engines(const char *input_name, const char *data, size_t size)
+{
+	output_buffer_t expected, actual;
+	int options, i, mismatches = 0;
+
+	for (options = 0; options <= (CONVERT_LINE_NUMBERS | CONVERT_EMBED_CSS | CONVERT_COMPACT); options++)
+	{
+		if (!open_memory_output_buffer(&expected))
+			return 1;
+		convert_with_reference(data, size, options, &expected);
+		for (i = 0; i < (int)(sizeof(engines) / sizeof(engines[0])); i++)
+		{
+			if (!open_memory_output_buffer(&actual))
+			{
+				mismatches++;
+				break;
+			}
+			if (engines[i].convert(data, size, options, &actual)
+				&& (actual.length != expected.length || memcmp(actual.data, expected.data, actual.length) != 0))
+			{
+				report_difference(input_name, engines[i].name, options, &expected, &actual);
+				mismatches++;
+			}
+			close_output_buffer(&actual);
+		}
+		close_output_buffer(&expected);
+	}
+	return mismatches;
+}
+
+#ifndef S2HTML_LIBFUZZER	/* golden files and random inputs belong to the stand-alone harness */
+
+/* Inputs the lexer has historically got wrong or that end inside a token */
+static const char *const adversarial_inputs[] = {
+	"", "\n", "\n\n\n", "\r\n", "\t \t", "<>&\"'", "/", "*", "#",
+	"/* unterminated", "/*", "/*/", "/**/", "/***/", "*/", "/* a */ */", "/* \n\n */x", "// line\\\ncontinued", "//",
+	"'", "''", "'a", "'a'", "'ab'", "'\\'", "'\\\\'", "'\\''", "'\\n'", "'\\", "'\n'", "'<'", "'&'", "'\"'",
+	"\"", "\"unterminated", "\"\\\"\"", "\"\\\\\"", "\"a\\\nb\"", "\"<&>\"",
+	"\"%\"", "\"%%\"", "\"%d%%%-*.*lf%\"", "\"%%d\"", "\"%5$s\"", "\"%#08.3llx\"", "\"%\n\"", "\"%.\"", "\"%ls%hhd%zu%\"",
+	"#include <", "#include <stdio.h", "#include <a>b>", "#include \"x", "#include\"x.h\"", "#  include <x.h>",
+	"#define A(x) #x", "#define S \"str\" 'c' /* c */", "#endif", "#endif\n", "#if 0\n#else\n#endif\n", "#\n", "# /* x */ define",
+	"0x", "0x1fUL", "1e+", "1.2.3", ".5f", "08", "1'000", "a/b/c", "a//b", "a/*b*/c", "int", "_Bool", "if(x)else{}",
+	"int main(void) { printf(\"%d\\n\", 'a'); return 0; }\n",
+};
+
+/* Compares expected with the golden file at golden_path, or rewrites the file with it; returns mismatches */
+static int check_golden_file(const char *input_name, const char *golden_path, const output_buffer_t *expected, int update)
+{
+	source_buffer_t golden;
+	FILE *golden_stream;
+	size_t offset = 0, golden_length;
+
+	if (update)
+	{
+		golden_stream = fopen(golden_path, "w");
+		if (golden_stream == NULL || fwrite(expected->data, 1, expected->length, golden_stream) != expected->length)
+		{
+			fprintf(stderr, "Error! could not write %s\n", golden_path);
+			if (golden_stream)
+				fclose(golden_stream);
+			return 1;
+		}
+		return fclose(golden_stream) != 0;
+	}
+	if (!open_source_buffer(&golden, golden_path))
+	{
+		fprintf(stderr, "MISSING golden file %s\n", golden_path);
+		return 1;
+	}
+	golden_length = golden.length;
+	while (offset < golden_length && offset < expected->length && golden.data[offset] == expected->data[offset])
+		offset++;
+	close_source_buffer(&golden);
+	if (offset == golden_length && offset == expected->length)
+		return 0;
+	fprintf(stderr, "MISMATCH %s: output differs from golden file %s at byte %zu\n", input_name, golden_path, offset);
+	return 1;
+}
+
+/* Checks the reference HTML of a file against <golden_directory>/<file name>[.n].html, or rewrites them; returns mismatches */
+static int compare_golden(const char *input_path, const char *data, size_t size, const char *golden_directory, int update)
+{
+	char golden_path[GOLDEN_PATH_LENGTH];
+	const char *base_name = strrchr(input_path, '/') ? strrchr(input_path, '/') + 1 : input_path;
+	output_buffer_t expected;
+	int numbered, mismatches = 0;
+
+	for (numbered = 0; numbered <= 1; numbered++)
+	{
+		snprintf(golden_path, sizeof(golden_path), "%s/%s%s.html", golden_directory, base_name, numbered ? ".n" : "");
+		if (!open_memory_output_buffer(&expected))
+			return mismatches + 1;
+		convert_with_reference(data, size, numbered, &expected);
+		mismatches += check_golden_file(input_path, golden_path, &expected, update);
+		close_output_buffer(&expected);
+	}
+	return mismatches;
+}
+
+/* Checks the reference HTML of every adversarial input, one document after the other, against
+   <golden_directory>/adversarial[.n].html, or rewrites them; returns mismatches */
+static int compare_golden_adversarial(const char *golden_directory, int update)
+{
+	char golden_path[GOLDEN_PATH_LENGTH];
+	output_buffer_t expected;
+	int numbered, i, mismatches = 0;
+
+	for (numbered = 0; numbered <= 1; numbered++)
+	{
+		snprintf(golden_path, sizeof(golden_path), "%s/%s%s.html", golden_directory, GOLDEN_ADVERSARIAL_NAME, numbered ? ".n" : "");
+		if (!open_memory_output_buffer(&expected))
+			return mismatches + 1;
+		for (i = 0; i < (int)(sizeof(adversarial_inputs) / sizeof(adversarial_inputs[0])); i++)
+			convert_with_reference(adversarial_inputs[i], strlen(adversarial_inputs[i]), numbered, &expected);
+		mismatches += check_golden_file("adversarial inputs", golden_path, &expected, update);
+		close_output_buffer(&expected);
+	}
+	return mismatches;
+}
+
+/* xorshift64*: deterministic so a failing seed can be replayed */
+static unsigned long long next_random(unsigned long long *state)
+{
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return *state * 0x2545f4914f6cdd1dULL;
+}
+
+/* Builds a random input from adversarial pieces, C punctuation and arbitrary bytes; returns its length */
+static size_t build_random_input(output_buffer_t *input, unsigned long long *state)
+{
+	static const char punctuation[] = "/*'\"\\%#<>&\n \t{}();,.0123456789abcdefxXuUlL_-+=!?:[]";
+	int pieces = 1 + (int)(next_random(state) % RANDOM_INPUT_PIECES), kind;
+	const char *piece;
+	char byte;
+
+	input->length = 0;
+	while (pieces-- > 0)
+	{
+		kind = (int)(next_random(state) % 4);
+		if (kind < 2)
+		{
+			piece = adversarial_inputs[next_random(state) % (sizeof(adversarial_inputs) / sizeof(adversarial_inputs[0]))];
+			output_append(input, piece, strlen(piece));
+		}
+		else if (kind == 2)
+		{
+			output_append_char(input, punctuation[next_random(state) % (sizeof(punctuation) - 1)]);
+		}
+		else
+		{
+			byte = (char)(next_random(state) & 0xff);
+			output_append_char(input, byte);
+		}
+	}
+	return input->length;
+}
+
+#endif
+
+/* ********************************************************************************************************************** */
+/* ********************************************************************************************************************** */
+
+/********** libFuzzer entry point **********/
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	if (compare_engines("fuzz input", (const char *)data, size) != 0)
+		abort();
+	return 0;
+}
+
+#ifndef S2HTML_LIBFUZZER
+
+static void print_usage(void)
+{
+	printf("Usage: <executable> [--random <count>] [--seed <n>] [--golden <dir> [--update-golden]] [file ...]\n");
+	printf("  Built-in adversarial inputs are always checked; every engine must match the reference HTML byte for byte\n");
+	printf("  --random : Also check this many random inputs built from adversarial pieces and arbitrary bytes\n");
+	printf("  --seed : Seed of the random inputs (default %d)\n", DEFAULT_RANDOM_SEED);
+	printf("  --golden : Also compare the reference HTML of each file with <dir>/<file name>.html and .n.html, and of the\n");
+	printf("             built-in inputs with <dir>/%s.html and .n.html\n", GOLDEN_ADVERSARIAL_NAME);
+	printf("  --update-golden : Rewrite the golden files from the current reference output instead, for an intended change\n");
+	printf("Example : ./s2html_fuzz test src/*.c\n");
+	printf("Example : ./s2html_fuzz --random 100000 --seed 7\n");
+	printf("Example : ./s2html_fuzz --golden golden test\n");
+}
+
+/********** harness entry point **********/
+
+int main(int argc, char *argv[])
+{
+	source_buffer_t source;
+	output_buffer_t input;
+	const char *golden_directory = NULL;
+	char input_name[64];
+	unsigned long long seed = DEFAULT_RANDOM_SEED, state;
+	long random_count = 0, round;
+	int update_golden = 0, checked = 0, mismatches = 0, i;
+
+	for (i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--random") == 0 && i + 1 < argc)
+			random_count = atol(argv[++i]);
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+			seed = strtoull(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--golden") == 0 && i + 1 < argc)
+			golden_directory = argv[++i];
+		else if (strcmp(argv[i], "--update-golden") == 0)
+			update_golden = 1;
+		else if (argv[i][0] == '-')
+		{
+			print_usage();
+			return 1;
+		}
+	}
+
+	for (i = 0; i < (int)(sizeof(adversarial_inputs) / sizeof(adversarial_inputs[0])); i++, checked++)
+	{
+		snprintf(input_name, sizeof(input_name), "adversarial input %d", i);
+		mismatches += compare_engines(input_name, adversarial_inputs[i], strlen(adversarial_inputs[i]));
+	}
+	if (golden_directory)
+		mismatches += compare_golden_adversarial(golden_directory, update_golden);
+
+	for (i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--random") == 0 || strcmp(argv[i], "--seed") == 0 || strcmp(argv[i], "--golden") == 0)
+		{
+			i++;
+			continue;
+		}
+		if (argv[i][0] == '-')
+			continue;
+		if (!open_source_buffer(&source, argv[i]))
+		{
+			fprintf(stderr, "Error! File %s could not be opened\n", argv[i]);
+			mismatches++;
+			continue;
+		}
+		mismatches += compare_engines(argv[i], source.data, source.length);
+		if (golden_directory)
+			mismatches += compare_golden(argv[i], source.data, source.length, golden_directory, update_golden);
+		close_source_buffer(&source);
+		checked++;
+	}
+
+	if (random_count > 0)
+	{
+		if (!open_memory_output_buffer(&input))
+		{
+			fprintf(stderr, "Error! could not allocate the input buffer\n");
+			return 3;
+		}
+		state = seed ? seed : DEFAULT_RANDOM_SEED;
+		for (round = 0; round < random_count; round++, checked++)
+		{
+			snprintf(input_name, sizeof(input_name), "random input %ld (seed %llu)", round, seed);
+			mismatches += compare_engines(input_name, input.data, build_random_input(&input, &state));
+		}
+		close_output_buffer(&input);
+	}
+
+	printf("%d inputs checked against %d engines, %d mismatches\n", checked, (int)(sizeof(engines) / sizeof(engines[0])), mismatches);
+	return mismatches ? 4 : 0;
+}
+
+#endif
@@ -0,0 +1,437 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "s2html_event.h"
+#include "s2html_conv.h"
+#include "s2html_incremental.h"
+
+#define FNV_OFFSET_BASIS	0xcbf29ce484222325ULL
+#define FNV_PRIME			0x100000001b3ULL
+#define STATE_FILE_MAGIC	"s2hstate"
+
+/*
+ * Next to the HTML of a file the converter keeps, for every source line, a hash of the line and the lexer and
+ * emitter state at the first token boundary at or after the line start. After an edit the unchanged lines at the
+ * start and at the end of the file are found by comparing hashes. The old HTML is reused up to the last boundary the
+ * edit cannot have influenced, the source is lexed again from there, and as soon as a boundary in the unchanged tail
+ * is reached in the same state as in the previous version the rest of the old HTML is copied, with its gutters
+ * renumbered when the edit changed the number of lines in front of them.
+ *
+ * The lexer peeks up to LEXER_CONTEXT_BYTES past a boundary before reporting it and looks back as far behind it,
+ * so a boundary is only trusted when that many bytes around it are known to be unchanged.
+ *
+ * The old HTML is only spliced when its length and a hash of its bytes in front of the first boundary and behind the
+ * last one (the document header, the last line and the footer) are still those the state file recorded.
+ */
+
+/* Entry state of one source line */
+typedef struct
+{
+	size_t start;				// offset of the line in the source, only meaningful for the new version
+	unsigned long long hash;	// FNV-1a of the line's bytes including its newline
+	int has_boundary;			// 0 => one token runs from before the line start to the end of the source
+	lexer_checkpoint_t boundary;	// first token boundary at or after the line start
+	int line_start;				// emitter gutter pending at the boundary
+	int line_number;			// emitter line counter at the boundary
+	size_t output_offset;		// HTML bytes written before the boundary
+}line_record_t;
+
+typedef struct
+{
+	line_record_t *lines;
+	size_t line_count;
+	size_t source_length;
+	size_t html_length;
+	unsigned long long html_edge_hash;	// see hash_html_edges
+	int enable_line_numbers;
+}line_state_t;
+
+/* State file: this header followed by line_count records; it is a cache for one machine, not a portable format */
+typedef struct
+{
+	char magic[8];				// STATE_FILE_MAGIC without its NUL
+	int version;				// INCREMENTAL_STATE_VERSION
+	int enable_line_numbers;	// gutters in the HTML the records describe
+	size_t source_length;
+	size_t html_length;
+	unsigned long long html_edge_hash;
+	size_t line_count;
+}state_file_header_t;
+
+/********** Helper function implementations **********/
+
+/* Splits source into lines and hashes them; returns 0 when out of memory */
+static int index_lines(const source_buffer_t *source, line_state_t *state)
+{
+	const char *data = source->data, *end = data + source->length, *newline;
+	unsigned long long hash;
+	size_t count = 0, i;
+
+	for (newline = data; newline < end && (newline = memchr(newline, '\n', end - newline)) != NULL; newline++)
+		count++;
+	if (source->length > 0 && data[source->length - 1] != '\n')
+		count++;
+
+	state->line_count = count;
+	state->source_length = source->length;
+	if (NULL == (state->lines = calloc(count ? count : 1, sizeof(*state->lines))))
+		return 0;
+
+	for (i = 0; i < count; i++)
+	{
+		state->lines[i].start = data - source->data;
+		for (hash = FNV_OFFSET_BASIS; data < end; )
+		{
+			hash = (hash ^ (unsigned char)*data) * FNV_PRIME;
+			if (*data++ == '\n')
+				break;
+		}
+		state->lines[i].hash = hash;
+	}
+	return 1;
+}
+
+/* FNV-1a of the HTML in front of the first recorded boundary and behind the last one; returns 0 when the records
+   point past the end of html */
+static int hash_html_edges(const source_buffer_t *html, const line_state_t *state, unsigned long long *hash)
+{
+	size_t head_end = html->length, tail_start = html->length, i;
+
+	for (i = 0; i < state->line_count; i++)
+	{
+		if (!state->lines[i].has_boundary)
+			continue;
+		if (head_end == html->length)
+			head_end = state->lines[i].output_offset;
+		tail_start = state->lines[i].output_offset;
+	}
+	if (head_end > html->length || tail_start > html->length)
+		return 0;
+
+	*hash = FNV_OFFSET_BASIS;
+	for (i = 0; i < head_end; i++)
+		*hash = (*hash ^ (unsigned char)html->data[i]) * FNV_PRIME;
+	for (i = head_end > tail_start ? head_end : tail_start; i < html->length; i++)
+		*hash = (*hash ^ (unsigned char)html->data[i]) * FNV_PRIME;
+	return 1;
+}
+
+/* Reads the line state written for the previous version; returns 0 if it is missing or malformed */
+static int load_line_state(const char *path, line_state_t *state)
+{
+	state_file_header_t header;
+	FILE *stream;
+	int ok;
+
+	if (NULL == (stream = fopen(path, "rb")))
+		return 0;
+	ok = fread(&header, sizeof(header), 1, stream) == 1
+		&& memcmp(header.magic, STATE_FILE_MAGIC, sizeof(header.magic)) == 0
+		&& header.version == INCREMENTAL_STATE_VERSION
+		&& NULL != (state->lines = malloc((header.line_count ? header.line_count : 1) * sizeof(*state->lines)))
+		&& fread(state->lines, sizeof(*state->lines), header.line_count, stream) == header.line_count;
+	fclose(stream);
+	if (!ok)
+		return 0;
+
+	state->line_count = header.line_count;
+	state->source_length = header.source_length;
+	state->html_length = header.html_length;
+	state->html_edge_hash = header.html_edge_hash;
+	state->enable_line_numbers = header.enable_line_numbers;
+	return 1;
+}
+
+/* Writes the line state of the new version to path; returns 0 on failure */
+static int save_line_state(const char *path, const line_state_t *state)
+{
+	state_file_header_t header;
+	FILE *stream;
+	int ok;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, STATE_FILE_MAGIC, sizeof(header.magic));
+	header.version = INCREMENTAL_STATE_VERSION;
+	header.enable_line_numbers = state->enable_line_numbers;
+	header.source_length = state->source_length;
+	header.html_length = state->html_length;
+	header.html_edge_hash = state->html_edge_hash;
+	header.line_count = state->line_count;
+
+	if (NULL == (stream = fopen(path, "wb")))
+		return 0;
+	ok = fwrite(&header, sizeof(header), 1, stream) == 1
+		&& fwrite(state->lines, sizeof(*state->lines), state->line_count, stream) == state->line_count;
+	return fclose(stream) == 0 && ok;
+}
+
+/* Copies the boundary fields of a record, keeping the line's own start and hash */
+static void copy_boundary(line_record_t *line, const line_record_t *boundary)
+{
+	line->has_boundary = 1;
+	line->boundary = boundary->boundary;
+	line->line_start = boundary->line_start;
+	line->line_number = boundary->line_number;
+	line->output_offset = boundary->output_offset;
+}
+
+/* Old record describes the new boundary once the bytes the edit inserted or removed are accounted for */
+static int boundary_matches(const line_record_t *old_line, const line_record_t *boundary, const line_state_t *previous, const line_state_t *state)
+{
+	lexer_checkpoint_t shifted;
+
+	if (!old_line->has_boundary || old_line->line_start != boundary->line_start)
+		return 0;
+	shifted = old_line->boundary;
+	shifted.position = shifted.position + state->source_length - previous->source_length;
+	return lexer_checkpoints_equal(&shifted, &boundary->boundary);
+}
+
+/*
+ * Lexes source from entry, storing the entry state of every line from first_line on, until the end of the source or
+ * until a line from first_suffix_line on reaches the same boundary as in previous. Returns the index of that line, or
+ * state->line_count when the lexer ran to the end.
+ */
+static size_t relex_lines(source_buffer_t *source, line_state_t *state, size_t first_line, const line_record_t *entry,
+						  output_buffer_t *output, const line_state_t *previous, size_t first_suffix_line)
+{
+	s2html_lexer_t lexer;
+	s2html_emitter_t emitter;
+	parser_token_t *token;
+	line_record_t boundary = *entry;
+	size_t next_line = first_line, trusted_from = (size_t)-1;
+
+	if (previous && first_suffix_line < state->line_count)
+		trusted_from = state->lines[first_suffix_line].start + LEXER_CONTEXT_BYTES;
+
+	init_lexer(&lexer, source);
+	restore_lexer_checkpoint(&lexer, &entry->boundary);
+	init_emitter(&emitter, output, state->enable_line_numbers);
+	emitter.current_line_number = entry->line_number;
+	emitter.line_start = entry->line_start;
+
+	for (;;)
+	{
+		/* The boundary is the entry state of every line that starts at or before it */
+		for (; next_line < state->line_count && state->lines[next_line].start <= boundary.boundary.position; next_line++)
+		{
+			copy_boundary(&state->lines[next_line], &boundary);
+			if (next_line >= first_suffix_line && boundary.boundary.position >= trusted_from
+				&& boundary_matches(&previous->lines[next_line + previous->line_count - state->line_count], &boundary, previous, state))
+				return next_line;
+		}
+
+		token = extract_next_token(&lexer);
+		convert_token_to_html(&emitter, token);
+		if (token->type == TOKEN_END_OF_FILE)
+			return state->line_count;
+
+		save_lexer_checkpoint(&lexer, &boundary.boundary);
+		boundary.line_start = emitter.line_start;
+		boundary.line_number = emitter.current_line_number;
+		boundary.output_offset = output->bytes_written + output->length;
+	}
+}
+
+/* Copies the old HTML behind the line the lexers reconverged at, and the line state of the unchanged tail with it */
+static void splice_tail(output_buffer_t *output, const source_buffer_t *old_html, line_state_t *state, const line_state_t *previous, size_t line)
+{
+	const line_record_t *old_line = &previous->lines[line + previous->line_count - state->line_count];
+	int delta = state->lines[line].line_number - old_line->line_number;
+	size_t copied_from = old_line->output_offset;
+	line_record_t *new_line;
+
+	/* Segments end at token boundaries, so none of them splits a gutter span */
+	for (line++; line < state->line_count; line++)
+	{
+		old_line = &previous->lines[line + previous->line_count - state->line_count];
+		new_line = &state->lines[line];
+		if (!old_line->has_boundary)
+			continue;
+		append_renumbered_html(output, old_html->data + copied_from, old_line->output_offset - copied_from, delta);
+		copied_from = old_line->output_offset;
+		copy_boundary(new_line, old_line);
+		new_line->boundary.position = new_line->boundary.position + state->source_length - previous->source_length;
+		new_line->line_number += delta;
+		new_line->output_offset = output->bytes_written + output->length;
+	}
+	append_renumbered_html(output, old_html->data + copied_from, old_html->length - copied_from, delta);
+}
+
+/* Picks the line to lex again from: the last one whose recorded boundary lies before the first changed byte */
+static int find_resume_line(const line_state_t *previous, size_t first_changed_line, size_t change_start, size_t *resume_line)
+{
+	size_t line = first_changed_line < previous->line_count ? first_changed_line : previous->line_count;
+
+	while (line-- > 0)
+	{
+		if (previous->lines[line].has_boundary && previous->lines[line].boundary.position + LEXER_CONTEXT_BYTES <= change_start)
+		{
+			*resume_line = line;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Writes the new HTML to output: spliced from old_html when previous describes it, otherwise converted in full */
+static void write_incremental_html(source_buffer_t *source, output_buffer_t *output, line_state_t *state,
+								   const line_state_t *previous, const source_buffer_t *old_html, incremental_result_t *result)
+{
+	s2html_emitter_t emitter;
+	s2html_lexer_t fresh;
+	line_record_t entry;
+	size_t first_changed = 0, suffix_lines = 0, common, change_start, resume_line = 0, converged_line, i;
+
+	if (previous)
+	{
+		common = state->line_count < previous->line_count ? state->line_count : previous->line_count;
+		while (first_changed < common && state->lines[first_changed].hash == previous->lines[first_changed].hash)
+			first_changed++;
+		while (suffix_lines < common - first_changed
+			   && state->lines[state->line_count - 1 - suffix_lines].hash == previous->lines[previous->line_count - 1 - suffix_lines].hash)
+			suffix_lines++;
+
+		/* Same lines: the old HTML is the new one, nothing is lexed */
+		if (first_changed == state->line_count && state->line_count == previous->line_count && state->source_length == previous->source_length)
+		{
+			result->reused = 1;
+			for (i = 0; i < state->line_count; i++)
+				if (previous->lines[i].has_boundary)
+					copy_boundary(&state->lines[i], &previous->lines[i]);
+			output_append(output, old_html->data, old_html->length);
+			return;
+		}
+
+		change_start = first_changed < state->line_count ? state->lines[first_changed].start : state->source_length;
+		if (!find_resume_line(previous, first_changed, change_start, &resume_line))
+			previous = NULL;
+	}
+
+	if (previous)
+	{
+		/* Everything in front of the resume boundary is unchanged, HTML and line state alike */
+		result->reused = 1;
+		for (i = 0; i < resume_line; i++)
+			copy_boundary(&state->lines[i], &previous->lines[i]);
+		entry = previous->lines[resume_line];
+		output_append(output, old_html->data, entry.output_offset);
+	}
+	else
+	{
+		init_emitter(&emitter, output, state->enable_line_numbers);
+		generate_html_header(&emitter, HTML_DOCUMENT_START);
+		init_lexer(&fresh, source);
+		save_lexer_checkpoint(&fresh, &entry.boundary);
+		entry.line_start = emitter.line_start;
+		entry.line_number = emitter.current_line_number;
+		entry.output_offset = output->bytes_written + output->length;
+	}
+
+	converged_line = relex_lines(source, state, resume_line, &entry, output, previous, state->line_count - suffix_lines);
+	result->first_relexed_line = resume_line + 1;
+	result->relexed_lines = (converged_line < state->line_count ? converged_line + 1 : state->line_count) - resume_line;
+
+	if (converged_line < state->line_count)
+	{
+		splice_tail(output, old_html, state, previous, converged_line);
+	}
+	else
+	{
+		init_emitter(&emitter, output, state->enable_line_numbers);
+		generate_html_footer(&emitter, HTML_DOCUMENT_END);
+	}
+}
+
+/* Records the edge hash of the HTML just written to path in state; returns 0 if it cannot be read */
+static int hash_written_html(const char *path, line_state_t *state)
+{
+	source_buffer_t html;
+	int ok;
+
+	if (!open_source_buffer(&html, path))
+		return 0;
+	ok = hash_html_edges(&html, state, &state->html_edge_hash);
+	close_source_buffer(&html);
+	return ok;
+}
+
+/* Fills path with suffix appended to base; returns 0 if it does not fit */
+static int build_sibling_path(char *path, const char *base, const char *suffix)
+{
+	return snprintf(path, INCREMENTAL_PATH_LENGTH, "%s%s", base, suffix) < INCREMENTAL_PATH_LENGTH;
+}
+
+/* ********************************************************************************************************************** */
+/* ********************************************************************************************************************** */
+
+/* Converts input_path to output_path, reusing the previous output where the source did not change; returns NULL on
+   success or a description of the failure */
+const char *convert_file_incremental(const char *input_path, const char *output_path, int enable_line_numbers, incremental_result_t *result)
+{
+	char state_path[INCREMENTAL_PATH_LENGTH], temporary_path[INCREMENTAL_PATH_LENGTH], temporary_state_path[INCREMENTAL_PATH_LENGTH];
+	source_buffer_t source, old_html;
+	line_state_t state = {0}, previous = {0};
+	output_buffer_t destination;
+	FILE *destination_stream;
+	const char *error = NULL;
+	unsigned long long old_edge_hash;
+	int have_previous, have_old_html = 0;
+
+	memset(result, 0, sizeof(*result));
+	if (!build_sibling_path(state_path, output_path, INCREMENTAL_STATE_SUFFIX)
+		|| !build_sibling_path(temporary_path, output_path, ".tmp")
+		|| !build_sibling_path(temporary_state_path, state_path, ".tmp"))
+		return "output path too long";
+	if (!open_source_buffer(&source, input_path))
+		return "could not be opened";
+	if (!index_lines(&source, &state))
+	{
+		close_source_buffer(&source);
+		return "out of memory";
+	}
+	state.enable_line_numbers = enable_line_numbers;
+	result->line_count = state.line_count;
+
+	/* The previous HTML is only trusted together with a state file that describes exactly that HTML */
+	have_previous = load_line_state(state_path, &previous) && previous.enable_line_numbers == enable_line_numbers
+		&& (have_old_html = open_source_buffer(&old_html, output_path)) && old_html.length == previous.html_length
+		&& hash_html_edges(&old_html, &previous, &old_edge_hash) && old_edge_hash == previous.html_edge_hash;
+
+	if (NULL == (destination_stream = fopen(temporary_path, "w")))
+	{
+		error = "could not create output file";
+	}
+	else if (!open_output_buffer(&destination, destination_stream))
+	{
+		error = "could not allocate output buffer";
+		fclose(destination_stream);
+	}
+	else
+	{
+		write_incremental_html(&source, &destination, &state, have_previous ? &previous : NULL, &old_html, result);
+		state.html_length = destination.bytes_written + destination.length;
+		if (!close_output_buffer(&destination))
+			error = "could not write output file";
+		if (fclose(destination_stream) != 0 && error == NULL)
+			error = "could not write output file";
+		if (error == NULL && !hash_written_html(temporary_path, &state))
+			error = "could not read back output file";
+		if (error == NULL && !save_line_state(temporary_state_path, &state))
+			error = "could not write state file";
+		if (error == NULL && (rename(temporary_path, output_path) != 0 || rename(temporary_state_path, state_path) != 0))
+			error = "could not replace output file";
+		if (error)
+		{
+			remove(temporary_path);
+			remove(temporary_state_path);
+		}
+	}
+
+	if (have_old_html)
+		close_source_buffer(&old_html);
+	close_source_buffer(&source);
+	free(previous.lines);
+	free(state.lines);
+	return error;
+}
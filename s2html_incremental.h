@@ -0,0 +1,21 @@
+#ifndef S2HTML_INCREMENTAL_H
+#define S2HTML_INCREMENTAL_H
+
+#define INCREMENTAL_STATE_SUFFIX	".state"	/* the line state is kept next to the HTML as <output>.state */
+#define INCREMENTAL_STATE_VERSION	2
+#define INCREMENTAL_PATH_LENGTH		4096
+
+typedef struct
+{
+	int reused;					// the previous HTML and its line state were valid and reused
+	size_t line_count;			// lines in the new source
+	size_t first_relexed_line;	// 1 based first line lexed again, 0 when the source did not change
+	size_t relexed_lines;		// lines lexed again before the lexer state reconverged, 0 when the source did not change
+}incremental_result_t;
+
+/********** function prototypes **********/
+
+const char *convert_file_incremental(const char *input_path, const char *output_path, int enable_line_numbers, incremental_result_t *result);
+
+#endif
+/**** End of file ****/
@@ -0,0 +1,213 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "s2html_input.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define SOURCE_CAN_MAP 1
+#endif
+
+/********** Helper function implementations **********/
+
+/* Reads the whole stream into a heap buffer, used when mapping is not possible */
+static int read_whole_stream(source_buffer_t *source, FILE *input_stream)
+{
+	char *buffer = NULL, *grown;
+	size_t capacity = 0, length = 0, count;
+
+	do
+	{
+		if (capacity - length < SOURCE_READ_CHUNK)
+		{
+			capacity = capacity ? capacity * 2 : SOURCE_READ_CHUNK;
+			if (NULL == (grown = realloc(buffer, capacity)))
+			{
+				free(buffer);
+				return 0;
+			}
+			buffer = grown;
+		}
+		count = fread(buffer + length, 1, capacity - length, input_stream);
+		length += count;
+	} while (count > 0);
+
+	if (ferror(input_stream))
+	{
+		free(buffer);
+		return 0;
+	}
+
+	source->data = buffer;
+	source->length = length;
+	source->origin = SOURCE_ORIGIN_BUFFERED;
+	return 1;
+}
+
+/* Slides the stream window so that it holds the first needed bytes (cursor relative offsets shift with it); returns 1 if they are available */
+static int fill_stream_window(source_buffer_t *source, size_t needed)
+{
+	size_t keep_from, count;
+	char *grown;
+
+	if (source->origin != SOURCE_ORIGIN_STREAM)
+		return 0;
+
+	while (source->length < needed && !source->stream_ended)
+	{
+		/* Discard bytes that neither source_unget nor the pinned token can reach */
+		keep_from = source->position > SOURCE_KEEP_BEHIND ? source->position - SOURCE_KEEP_BEHIND : 0;
+		if (source->pinned < keep_from)
+			keep_from = source->pinned;
+		if (keep_from > 0)
+		{
+			memmove(source->window, source->window + keep_from, source->length - keep_from);
+			source->length -= keep_from;
+			source->position -= keep_from;
+			source->discarded += keep_from;
+			if (source->pinned != SOURCE_UNPINNED)
+				source->pinned -= keep_from;
+			needed -= keep_from;
+		}
+		if (source->length == source->window_size) /* one token fills the window */
+		{
+			if (NULL == (grown = realloc(source->window, source->window_size * 2)))
+			{
+				source->error = 1; /* out of memory: no more bytes, the conversion fails */
+				source->stream_ended = 1;
+				break;
+			}
+			source->window = grown;
+			source->data = grown;
+			source->window_size *= 2;
+		}
+		count = fread(source->window + source->length, 1, source->window_size - source->length, source->stream);
+		if (count == 0)
+		{
+			if (ferror(source->stream))
+				source->error = 1;
+			source->stream_ended = 1;
+		}
+		source->length += count;
+	}
+	return needed <= source->length;
+}
+
+/* ********************************************************************************************************************** */
+/* ********************************************************************************************************************** */
+
+/* Opens file_name and makes its bytes addressable; returns 1 on success, 0 on failure */
+int open_source_buffer(source_buffer_t *source, const char *file_name)
+{
+	FILE *input_stream;
+	int status;
+
+	memset(source, 0, sizeof(*source));
+	source->pinned = SOURCE_UNPINNED;
+
+#ifdef SOURCE_CAN_MAP
+	{
+		struct stat file_info;
+		void *mapping;
+		int descriptor;
+
+		if ((descriptor = open(file_name, O_RDONLY)) < 0)
+			return 0;
+		if (fstat(descriptor, &file_info) == 0 && S_ISREG(file_info.st_mode))
+		{
+			if (file_info.st_size == 0) /* nothing to map */
+			{
+				close(descriptor);
+				source->origin = SOURCE_ORIGIN_EMPTY;
+				return 1;
+			}
+			mapping = mmap(NULL, file_info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+			if (mapping != MAP_FAILED)
+			{
+				close(descriptor);
+#ifdef MADV_SEQUENTIAL
+				madvise(mapping, file_info.st_size, MADV_SEQUENTIAL);
+#endif
+				source->data = mapping;
+				source->length = file_info.st_size;
+				source->origin = SOURCE_ORIGIN_MAPPED;
+				return 1;
+			}
+		}
+		close(descriptor);
+	}
+#endif
+
+	/* Fall back to reading the whole file */
+	if (NULL == (input_stream = fopen(file_name, "rb")))
+		return 0;
+	status = read_whole_stream(source, input_stream);
+	fclose(input_stream);
+	return status;
+}
+
+/* Reads input_stream through a fixed window so that pipes and stdin work in constant memory; returns 1 on success, 0 on failure */
+int open_source_stream(source_buffer_t *source, FILE *input_stream)
+{
+	memset(source, 0, sizeof(*source));
+	source->pinned = SOURCE_UNPINNED;
+	if (NULL == (source->window = malloc(SOURCE_WINDOW_SIZE)))
+		return 0;
+	source->window_size = SOURCE_WINDOW_SIZE;
+	source->data = source->window;
+	source->stream = input_stream;
+	source->origin = SOURCE_ORIGIN_STREAM;
+	return 1;
+}
+
+/* Reads length bytes at data in place; they must outlive the source and are not released by close_source_buffer */
+void open_source_memory(source_buffer_t *source, const char *data, size_t length)
+{
+	memset(source, 0, sizeof(*source));
+	source->pinned = SOURCE_UNPINNED;
+	source->data = data;
+	source->length = length;
+	source->origin = SOURCE_ORIGIN_MEMORY;
+}
+
+/* Slow path of source_next_char: refills a stream window or reports EOF */
+int source_refill_next(source_buffer_t *source)
+{
+	if (source->position == source->length && fill_stream_window(source, source->position + 1))
+		return (unsigned char)source->data[source->position++];
+	source->position++;
+	return SOURCE_EOF;
+}
+
+/* Slow path of source_peek_char */
+int source_refill_peek(source_buffer_t *source, size_t offset)
+{
+	if (source->position <= source->length && fill_stream_window(source, source->position + offset + 1))
+		return (unsigned char)source->data[source->position + offset];
+	return SOURCE_EOF;
+}
+
+/* Releases the bytes held by source (a stream itself is left open for its owner) */
+void close_source_buffer(source_buffer_t *source)
+{
+	switch (source->origin)
+	{
+#ifdef SOURCE_CAN_MAP
+	case SOURCE_ORIGIN_MAPPED:
+		munmap((void *)source->data, source->length);
+		break;
+#endif
+	case SOURCE_ORIGIN_BUFFERED:
+		free((void *)source->data);
+		break;
+	case SOURCE_ORIGIN_STREAM:
+		free(source->window);
+		break;
+	default:
+		break;
+	}
+	memset(source, 0, sizeof(*source));
+}
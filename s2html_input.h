@@ -0,0 +1,78 @@
+#ifndef S2HTML_INPUT_H
+#define S2HTML_INPUT_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/* Source origin definitions */
+#define SOURCE_ORIGIN_EMPTY		0
+#define SOURCE_ORIGIN_MAPPED	1
+#define SOURCE_ORIGIN_BUFFERED	2
+#define SOURCE_ORIGIN_STREAM	3
+#define SOURCE_ORIGIN_MEMORY	4	/* borrowed bytes, owned by the caller */
+
+#define SOURCE_EOF				(-1)
+#define SOURCE_READ_CHUNK		65536
+#ifndef SOURCE_WINDOW_SIZE	/* can be overridden at build time, so tests can exercise refills with a tiny window */
+#define SOURCE_WINDOW_SIZE		65536	/* initial stream window, bounds memory use for pipes unless one token is longer */
+#endif
+#define SOURCE_KEEP_BEHIND		16		/* bytes retained behind the cursor when a stream window slides */
+#define SOURCE_UNPINNED			((size_t)-1)
+
+typedef struct
+{
+	const char *data;		// start of source bytes
+	size_t length;			// number of bytes available
+	size_t position;		// read cursor, may run one past length per EOF read
+	size_t pinned;			// first byte of the token being lexed (SOURCE_UNPINNED if none); a stream window keeps it
+	int origin;				// how data was obtained (mapped / buffered / stream)
+	FILE *stream;			// stream origin only: where the window is refilled from
+	char *window;			// stream origin only: sliding window, grows while a single token fills it
+	size_t window_size;		// stream origin only: allocated size of window
+	int stream_ended;		// stream origin only: set once the stream reported EOF
+	int error;				// stream origin only: set once a read or growing the window failed, the bytes end early
+	size_t discarded;		// stream origin only: bytes slid out of the window, data[0] is this far into the stream
+}source_buffer_t;
+
+/********** function prototypes **********/
+
+int open_source_buffer(source_buffer_t *source, const char *file_name);
+int open_source_stream(source_buffer_t *source, FILE *input_stream);
+void open_source_memory(source_buffer_t *source, const char *data, size_t length);
+void close_source_buffer(source_buffer_t *source);
+int source_refill_next(source_buffer_t *source);
+int source_refill_peek(source_buffer_t *source, size_t offset);
+
+/********** cursor helpers **********/
+
+/* Returns next byte and advances the cursor. EOF reads also advance so that every read can be undone by source_unget */
+static inline int source_next_char(source_buffer_t *source)
+{
+	if (source->position < source->length)
+		return (unsigned char)source->data[source->position++];
+	return source_refill_next(source);
+}
+
+/* Returns byte at offset from the cursor without consuming it */
+static inline int source_peek_char(source_buffer_t *source, size_t offset)
+{
+	size_t index = source->position + offset;
+	if (index < source->length)
+		return (unsigned char)source->data[index];
+	return source_refill_peek(source, offset);
+}
+
+/* Returns byte count reads behind the cursor (1 => byte just read) */
+static inline int source_look_back(const source_buffer_t *source, size_t count)
+{
+	return count <= source->position && source->position - count < source->length ? (unsigned char)source->data[source->position - count] : SOURCE_EOF;
+}
+
+/* Steps the cursor back over the last count reads (at most SOURCE_KEEP_BEHIND for streams) */
+static inline void source_unget(source_buffer_t *source, size_t count)
+{
+	source->position -= count;
+}
+
+#endif
+/**** End of file ****/
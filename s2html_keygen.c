@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Keyword table generator: reads the list in s2html_keywords.def and prints s2html_keywords.h,
+ * a collision free hash table classify_keyword indexes with one computation and one memcmp.
+ *
+ *   gcc s2html_keygen.c -o s2html_keygen && ./s2html_keygen > s2html_keywords.h
+ */
+
+#define MAX_TABLE_BITS		10
+#define MAX_MULTIPLIER		64
+
+typedef struct
+{
+	const char *word;
+	const char *classification;
+}keyword_entry_t;
+
+static const keyword_entry_t keyword_list[] = {
+#define KEYWORD(word, classification) { word, #classification },
+#include "s2html_keywords.def"
+#undef KEYWORD
+};
+
+#define KEYWORD_COUNT ((int)(sizeof(keyword_list) / sizeof(keyword_list[0])))
+
+/* Must stay identical to keyword_hash() in the generated header */
+static unsigned int hash_word(const char *word, unsigned int length, unsigned int first, unsigned int second, unsigned int last, unsigned int mask)
+{
+	return (length + (unsigned char)word[0] * first + (unsigned char)word[1] * second + (unsigned char)word[length - 1] * last) & mask;
+}
+
+/* Searches multipliers for a table of 2^bits slots without collisions; returns 1 when found */
+static int find_parameters(unsigned int bits, unsigned int *first, unsigned int *second, unsigned int *last)
+{
+	unsigned char used[1 << MAX_TABLE_BITS];
+	unsigned int mask = (1u << bits) - 1, slot;
+	int i;
+
+	for (*first = 1; *first < MAX_MULTIPLIER; (*first)++)
+		for (*second = 0; *second < MAX_MULTIPLIER; (*second)++)
+			for (*last = 0; *last < MAX_MULTIPLIER; (*last)++)
+			{
+				memset(used, 0, sizeof(used));
+				for (i = 0; i < KEYWORD_COUNT; i++)
+				{
+					slot = hash_word(keyword_list[i].word, strlen(keyword_list[i].word), *first, *second, *last, mask);
+					if (used[slot])
+						break;
+					used[slot] = 1;
+				}
+				if (i == KEYWORD_COUNT)
+					return 1;
+			}
+	return 0;
+}
+
+int main(void)
+{
+	const char *table[1 << MAX_TABLE_BITS];
+	const char *classification[1 << MAX_TABLE_BITS];
+	unsigned int bits, first, second, last, mask, slot, length;
+	unsigned int min_length = ~0u, max_length = 0;
+	int i;
+
+	for (i = 0; i < KEYWORD_COUNT; i++)
+	{
+		length = strlen(keyword_list[i].word);
+		if (length < 2)
+		{
+			fprintf(stderr, "Error! keyword \"%s\" is shorter than 2 characters\n", keyword_list[i].word);
+			return 1;
+		}
+		if (length < min_length)
+			min_length = length;
+		if (length > max_length)
+			max_length = length;
+	}
+
+	/* Smallest power of two table that admits a perfect hash */
+	for (bits = 1; (1 << bits) < KEYWORD_COUNT; bits++)
+		;
+	for (; bits <= MAX_TABLE_BITS; bits++)
+		if (find_parameters(bits, &first, &second, &last))
+			break;
+	if (bits > MAX_TABLE_BITS)
+	{
+		fprintf(stderr, "Error! no perfect hash found for %d keywords\n", KEYWORD_COUNT);
+		return 1;
+	}
+
+	mask = (1u << bits) - 1;
+	memset(table, 0, sizeof(table));
+	for (i = 0; i < KEYWORD_COUNT; i++)
+	{
+		slot = hash_word(keyword_list[i].word, strlen(keyword_list[i].word), first, second, last, mask);
+		table[slot] = keyword_list[i].word;
+		classification[slot] = keyword_list[i].classification;
+	}
+
+	printf("/* Generated by s2html_keygen from s2html_keywords.def - do not edit */\n\n");
+	printf("#ifndef S2HTML_KEYWORDS_H\n#define S2HTML_KEYWORDS_H\n\n");
+	printf("#define KEYWORD_COUNT\t\t\t%d\n", KEYWORD_COUNT);
+	printf("#define KEYWORD_MIN_LENGTH\t\t%u\n", min_length);
+	printf("#define KEYWORD_MAX_LENGTH\t\t%u\n", max_length);
+	printf("#define KEYWORD_TABLE_MASK\t\t%u\n\n", mask);
+	printf("typedef struct\n{\n\tconst char *word;\t\t// keyword text, NULL for empty slots\n");
+	printf("\tunsigned char length;\t// strlen(word)\n\tunsigned char classification;\t// DATATYPE_KEYWORD or CONTROL_KEYWORD\n}keyword_slot_t;\n\n");
+	printf("/* Caller guarantees KEYWORD_MIN_LENGTH <= length <= KEYWORD_MAX_LENGTH */\n");
+	printf("static inline unsigned int keyword_hash(const char *word, unsigned int length)\n{\n");
+	printf("\treturn (length + (unsigned char)word[0] * %uu + (unsigned char)word[1] * %uu + (unsigned char)word[length - 1] * %uu) & KEYWORD_TABLE_MASK;\n}\n\n",
+		   first, second, last);
+	printf("static const keyword_slot_t keyword_table[KEYWORD_TABLE_MASK + 1] = {\n");
+	for (slot = 0; slot <= mask; slot++)
+	{
+		if (table[slot])
+			printf("\t[%u] = {\"%s\", %u, %s},\n", slot, table[slot], (unsigned int)strlen(table[slot]), classification[slot]);
+	}
+	printf("};\n\n#endif\n/**** End of file ****/\n");
+	return 0;
+}
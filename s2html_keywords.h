@@ -0,0 +1,72 @@
+/* Generated by s2html_keygen from s2html_keywords.def - do not edit */
+
+#ifndef S2HTML_KEYWORDS_H
+#define S2HTML_KEYWORDS_H
+
+#define KEYWORD_COUNT			44
+#define KEYWORD_MIN_LENGTH		2
+#define KEYWORD_MAX_LENGTH		14
+#define KEYWORD_TABLE_MASK		127
+
+typedef struct
+{
+	const char *word;		// keyword text, NULL for empty slots
+	unsigned char length;	// strlen(word)
+	unsigned char classification;	// DATATYPE_KEYWORD or CONTROL_KEYWORD
+}keyword_slot_t;
+
+/* Caller guarantees KEYWORD_MIN_LENGTH <= length <= KEYWORD_MAX_LENGTH */
+static inline unsigned int keyword_hash(const char *word, unsigned int length)
+{
+	return (length + (unsigned char)word[0] * 1u + (unsigned char)word[1] * 9u + (unsigned char)word[length - 1] * 12u) & KEYWORD_TABLE_MASK;
+}
+
+static const keyword_slot_t keyword_table[KEYWORD_TABLE_MASK + 1] = {
+	[0] = {"union", 5, DATATYPE_KEYWORD},
+	[1] = {"do", 2, CONTROL_KEYWORD},
+	[4] = {"typedef", 7, DATATYPE_KEYWORD},
+	[6] = {"goto", 4, CONTROL_KEYWORD},
+	[8] = {"switch", 6, CONTROL_KEYWORD},
+	[9] = {"inline", 6, DATATYPE_KEYWORD},
+	[10] = {"_Generic", 8, CONTROL_KEYWORD},
+	[11] = {"unsigned", 8, DATATYPE_KEYWORD},
+	[12] = {"case", 4, CONTROL_KEYWORD},
+	[13] = {"double", 6, DATATYPE_KEYWORD},
+	[14] = {"continue", 8, CONTROL_KEYWORD},
+	[16] = {"short", 5, DATATYPE_KEYWORD},
+	[17] = {"void", 4, DATATYPE_KEYWORD},
+	[20] = {"_Alignas", 8, DATATYPE_KEYWORD},
+	[33] = {"volatile", 8, DATATYPE_KEYWORD},
+	[38] = {"_Imaginary", 10, DATATYPE_KEYWORD},
+	[39] = {"float", 5, DATATYPE_KEYWORD},
+	[40] = {"for", 3, CONTROL_KEYWORD},
+	[43] = {"long", 4, DATATYPE_KEYWORD},
+	[45] = {"return", 6, CONTROL_KEYWORD},
+	[49] = {"static", 6, DATATYPE_KEYWORD},
+	[54] = {"auto", 4, DATATYPE_KEYWORD},
+	[58] = {"int", 3, DATATYPE_KEYWORD},
+	[63] = {"const", 5, DATATYPE_KEYWORD},
+	[70] = {"_Bool", 5, DATATYPE_KEYWORD},
+	[72] = {"_Static_assert", 14, CONTROL_KEYWORD},
+	[73] = {"if", 2, CONTROL_KEYWORD},
+	[75] = {"extern", 6, DATATYPE_KEYWORD},
+	[78] = {"_Noreturn", 9, DATATYPE_KEYWORD},
+	[83] = {"_Atomic", 7, DATATYPE_KEYWORD},
+	[90] = {"signed", 6, DATATYPE_KEYWORD},
+	[95] = {"register", 8, DATATYPE_KEYWORD},
+	[96] = {"while", 5, CONTROL_KEYWORD},
+	[98] = {"_Complex", 8, DATATYPE_KEYWORD},
+	[99] = {"enum", 4, DATATYPE_KEYWORD},
+	[103] = {"char", 4, DATATYPE_KEYWORD},
+	[104] = {"default", 7, CONTROL_KEYWORD},
+	[109] = {"break", 5, CONTROL_KEYWORD},
+	[112] = {"_Thread_local", 13, DATATYPE_KEYWORD},
+	[113] = {"else", 4, CONTROL_KEYWORD},
+	[114] = {"sizeof", 6, CONTROL_KEYWORD},
+	[119] = {"restrict", 8, DATATYPE_KEYWORD},
+	[120] = {"_Alignof", 8, CONTROL_KEYWORD},
+	[125] = {"struct", 6, DATATYPE_KEYWORD},
+};
+
+#endif
+/**** End of file ****/
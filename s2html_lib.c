@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "s2html_event.h"
+#include "s2html_conv.h"
+#include "s2html.h"
+
+/*
+ * libs2html entry points: thin wrappers that run the same conversion as the command line tool on a memory source
+ * and a memory output buffer. Build the library from this file and the converter core, without s2html_main.c.
+ */
+
+#define S2HTML_OPTION_MASK		(S2HTML_LINE_NUMBERS | S2HTML_EMBED_CSS | S2HTML_COMPACT | S2HTML_LINE_ANCHORS)
+
+/* The public option values are the converter's flags, passed through unchanged */
+#if S2HTML_LINE_NUMBERS != CONVERT_LINE_NUMBERS || S2HTML_EMBED_CSS != CONVERT_EMBED_CSS || S2HTML_COMPACT != CONVERT_COMPACT \
+	|| S2HTML_LINE_ANCHORS != CONVERT_LINE_ANCHORS
+#error "s2html.h options out of step with the CONVERT_* flags in s2html_conv.h"
+#endif
+
+/* ********************************************************************************************************************** */
+/* ********************************************************************************************************************** */
+
+int s2html_convert(const char *source, size_t source_length, int options, char **html, size_t *html_length)
+{
+	source_buffer_t input;
+	output_buffer_t output;
+
+	if ((source == NULL && source_length > 0) || html == NULL || html_length == NULL || (options & ~S2HTML_OPTION_MASK))
+		return S2HTML_ERROR_ARGUMENT;
+	*html = NULL;
+	*html_length = 0;
+	if (!open_memory_output_buffer(&output))
+		return S2HTML_ERROR_MEMORY;
+
+	open_source_memory(&input, source ? source : "", source_length);
+	convert_source_to_html(&input, &output, options);
+	output_append_char(&output, '\0');
+	if (output.error)
+	{
+		close_output_buffer(&output);
+		return S2HTML_ERROR_MEMORY;
+	}
+
+	/* The grown buffer itself goes to the caller, nothing is copied */
+	*html = output.data;
+	*html_length = output.length - 1;
+	return S2HTML_OK;
+}
+
+int s2html_convert_to_buffer(const char *source, size_t source_length, int options, char *buffer, size_t capacity, size_t *html_length)
+{
+	source_buffer_t input;
+	output_buffer_t output;
+
+	if ((source == NULL && source_length > 0) || (buffer == NULL && capacity > 0) || html_length == NULL || (options & ~S2HTML_OPTION_MASK))
+		return S2HTML_ERROR_ARGUMENT;
+
+	open_fixed_output_buffer(&output, buffer, capacity);
+	open_source_memory(&input, source ? source : "", source_length);
+	convert_source_to_html(&input, &output, options);
+	*html_length = output.length + output.overflow;
+	if (output.error)
+		return output.overflow ? S2HTML_ERROR_TOO_SMALL : S2HTML_ERROR_MEMORY;
+	return S2HTML_OK;
+}
+
+void s2html_free(char *html)
+{
+	free(html);
+}
+
+const char *s2html_status_string(int status)
+{
+	switch (status)
+	{
+	case S2HTML_OK:
+		return "success";
+	case S2HTML_ERROR_ARGUMENT:
+		return "invalid argument";
+	case S2HTML_ERROR_MEMORY:
+		return "out of memory";
+	case S2HTML_ERROR_TOO_SMALL:
+		return "output buffer too small";
+	default:
+		return "unknown status";
+	}
+}
@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "s2html_lineindex.h"
+
+/*
+ * Sidecar format, for viewers that serve a window of lines without parsing the document. All numbers are little
+ * endian whatever the machine, so the file can be read anywhere:
+ *
+ *   header    "s2hlines", u32 version, u32 CONVERT_* options, u64 line count, u64 reserved (0)
+ *   records   line count + 1 times { u64 html offset, u64 source offset }
+ *
+ * Record n - 1 is where line n starts and the last record is where the last line ends, so a window of lines is
+ * found with two reads at fixed offsets: LINE_INDEX_HEADER_SIZE + 16 * (line - 1).
+ */
+
+/********** Helper function implementations **********/
+
+/* Stores value as 8 little endian bytes */
+static void put_u64(unsigned char *bytes, unsigned long long value)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		bytes[i] = (unsigned char)(value >> (8 * i));
+}
+
+/* Stores value as 4 little endian bytes */
+static void put_u32(unsigned char *bytes, unsigned int value)
+{
+	int i;
+
+	for (i = 0; i < 4; i++)
+		bytes[i] = (unsigned char)(value >> (8 * i));
+}
+
+/* Writes the binary form; returns 0 on a write error */
+static int write_binary_index(FILE *stream, const line_index_t *index, int options)
+{
+	unsigned char header[LINE_INDEX_HEADER_SIZE], record[16];
+	size_t i;
+
+	memset(header, 0, sizeof(header));
+	memcpy(header, LINE_INDEX_MAGIC, 8);
+	put_u32(header + 8, LINE_INDEX_VERSION);
+	put_u32(header + 12, (unsigned int)options);
+	put_u64(header + 16, index->count - 1);
+	if (fwrite(header, sizeof(header), 1, stream) != 1)
+		return 0;
+	for (i = 0; i < index->count; i++)
+	{
+		put_u64(record, index->html_base + index->html_offsets[i]);
+		put_u64(record + 8, index->source_offsets[i]);
+		if (fwrite(record, sizeof(record), 1, stream) != 1)
+			return 0;
+	}
+	return 1;
+}
+
+/* Writes the JSON form, the two offset lists side by side */
+static void write_json_index(FILE *stream, const line_index_t *index, int options)
+{
+	size_t i;
+
+	fprintf(stream, "{\"version\":%d,\"options\":%d,\"lines\":%zu,\"html\":[", LINE_INDEX_VERSION, options, index->count - 1);
+	for (i = 0; i < index->count; i++)
+		fprintf(stream, i ? ",%llu" : "%llu", index->html_base + index->html_offsets[i]);
+	fprintf(stream, "],\"source\":[");
+	for (i = 0; i < index->count; i++)
+		fprintf(stream, i ? ",%llu" : "%llu", index->source_offsets[i]);
+	fprintf(stream, "]}\n");
+}
+
+/* ********************************************************************************************************************** */
+/* ********************************************************************************************************************** */
+
+/* Prepares an empty index */
+void init_line_index(line_index_t *index)
+{
+	memset(index, 0, sizeof(*index));
+}
+
+/* Slow path of add_line_position: the arrays are full */
+void add_line_position_slow(line_index_t *index, unsigned long long html_offset, unsigned long long source_offset)
+{
+	size_t capacity = index->capacity ? index->capacity * 2 : 4096;
+	unsigned long long *html_offsets, *source_offsets;
+
+	if (index->failed)
+		return;
+	if (NULL == (html_offsets = realloc(index->html_offsets, capacity * sizeof(*html_offsets))))
+	{
+		index->failed = 1;
+		return;
+	}
+	index->html_offsets = html_offsets;
+	if (NULL == (source_offsets = realloc(index->source_offsets, capacity * sizeof(*source_offsets))))
+	{
+		index->failed = 1;
+		return;
+	}
+	index->source_offsets = source_offsets;
+	index->capacity = capacity;
+	add_line_position(index, html_offset, source_offset);
+}
+
+/* Closes the index with the end of the document: a position stored at the very end (after the final newline, or
+   of an empty source) is dropped, as no line starts there, and the end of the last line is stored */
+void end_line_index(line_index_t *index, unsigned long long html_offset, unsigned long long source_offset)
+{
+	if (index->count > 0 && index->source_offsets[index->count - 1] == source_offset)
+		index->count--;
+	add_line_position(index, html_offset, source_offset);
+}
+
+/* Writes the index to path, in binary or as JSON; returns NULL on success or a description of the failure */
+const char *save_line_index(const char *path, const line_index_t *index, int options, int json)
+{
+	FILE *stream;
+	int ok = 1;
+
+	if (index->failed || index->count == 0)
+		return "out of memory while indexing lines";
+	if (NULL == (stream = fopen(path, json ? "w" : "wb")))
+		return "could not create line index file";
+	if (json)
+		write_json_index(stream, index, options);
+	else
+		ok = write_binary_index(stream, index, options);
+	if (ferror(stream))
+		ok = 0;
+	if (fclose(stream) != 0 || !ok)
+		return "could not write line index file";
+	return NULL;
+}
+
+/* Releases the offset arrays */
+void free_line_index(line_index_t *index)
+{
+	free(index->html_offsets);
+	free(index->source_offsets);
+	init_line_index(index);
+}
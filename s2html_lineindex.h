@@ -0,0 +1,51 @@
+#ifndef S2HTML_LINEINDEX_H
+#define S2HTML_LINEINDEX_H
+
+#include <stddef.h>
+
+#define LINE_INDEX_SUFFIX		".lines"		/* the index is kept next to the HTML as <output>.lines */
+#define LINE_INDEX_JSON_SUFFIX	".lines.json"
+#define LINE_INDEX_MAGIC		"s2hlines"
+#define LINE_INDEX_VERSION		1
+#define LINE_INDEX_HEADER_SIZE	32				/* magic, version, options, line count, reserved */
+#define LINE_INDEX_PATH_LENGTH	4096
+
+/*
+ * Where every line starts in the HTML and in the source. Position n - 1 is the start of line n, numbered as the gutter
+ * numbers it: the byte after the newline that ended the line before it (the first byte of the body for line 1). One more position follows the
+ * last line and marks where its bytes end, so lines a..b are the HTML bytes [html[a - 1], html[b]) for any a <= b.
+ */
+typedef struct s2html_line_index
+{
+	unsigned long long *html_offsets;	// HTML file offset of each position
+	unsigned long long *source_offsets;	// source offset of each position
+	size_t count;				// positions stored
+	size_t capacity;
+	unsigned long long html_base;	// added to every html offset when saved, where the emitter's output lands in the file
+	int failed;					// out of memory, positions are incomplete
+}line_index_t;
+
+/********** function prototypes **********/
+
+void init_line_index(line_index_t *index);
+void add_line_position_slow(line_index_t *index, unsigned long long html_offset, unsigned long long source_offset);
+void end_line_index(line_index_t *index, unsigned long long html_offset, unsigned long long source_offset);
+const char *save_line_index(const char *path, const line_index_t *index, int options, int json);
+void free_line_index(line_index_t *index);
+
+/********** append helpers **********/
+
+/* Stores the next position */
+static inline void add_line_position(line_index_t *index, unsigned long long html_offset, unsigned long long source_offset)
+{
+	if (index->count == index->capacity)
+	{
+		add_line_position_slow(index, html_offset, source_offset);
+		return;
+	}
+	index->html_offsets[index->count] = html_offset;
+	index->source_offsets[index->count++] = source_offset;
+}
+
+#endif
+/**** End of file ****/
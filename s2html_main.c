@@ -1,95 +1,658 @@
+#include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "s2html_event.h"
 #include "s2html_conv.h"
+#include "s2html_batch.h"
+#include "s2html_parallel.h"
+#include "s2html_incremental.h"
+#include "s2html_pages.h"
+#include "s2html_lineindex.h"
+#include "s2html_server.h"
+#include "s2html_stats.h"
+
+/********** main program entry point **********/
+
+/* Prints the usage text */
+static void print_usage(void)
+{
+	fprintf(stderr, "\nError ! please enter file name and mode\n");
+	fprintf(stderr, "Usage: <executable> <file name | -> [output name] [-n] [-o output file] [-p threads] [--embed-css] [--compact] [--page-lines N] [--line-index[=json]] [--incremental] [--stats[=json]] [--lexer=dfa]\n");
+	fprintf(stderr, "       <executable> -j <workers> [--out-dir <dir>] [--cache <dir> [--cache-size <MB>] [--cache-link]] [--arena-size <KB>] [-n] [--embed-css] [--compact] [--lexer=dfa] [file ...]\n");
+	fprintf(stderr, "       <executable> --serve <socket> [-j <workers>] [--arena-size <KB>]\n");
+	fprintf(stderr, "       <executable> --connect <socket> <file name | -> [output name] [-n] [-o output file] [--embed-css] [--compact]\n");
+	fprintf(stderr, "       <executable> --connect <socket> --server-report\n");
+	fprintf(stderr, "  -n : Enable line numbers\n");
+	fprintf(stderr, "  -o : Write HTML to this exact path (- for stdout)\n");
+	fprintf(stderr, "  -p : Lex one large file on this many threads (no effect on stdin)\n");
+	fprintf(stderr, "  --embed-css : Inline the built in theme rules the file uses (all of them for stdin, which streams) instead of linking styles.css\n");
+	fprintf(stderr, "  --compact : Short class names and one span per run of same class tokens, styled by styles-compact.css\n");
+	fprintf(stderr, "  --page-lines : Write pages of this many lines as <output>.page<n>.html while lexing, <output> becomes their index\n");
+	fprintf(stderr, "  --line-index : Write where every line starts in the HTML and the source to <output>.lines, or <output>.lines.json with =json\n");
+	fprintf(stderr, "  --incremental : Re-render only the lines an edit affected, keeping line state in <output>.state\n");
+	fprintf(stderr, "  --stats : Print lexer/emitter counters on stderr as a table, or JSON with --stats=json (builds with -DS2HTML_STATS)\n");
+	fprintf(stderr, "  --lexer : dfa => lex with the transition table generated from s2html_lexer.def instead of the state handlers\n"
+				    "            (same HTML; not with -p, --incremental, --stats or the server), handlers => the default\n");
+	fprintf(stderr, "  -  : Read source from stdin (HTML goes to stdout unless -o is given)\n");
+	fprintf(stderr, "  -j : Batch mode, convert every file on this many threads (file list read from stdin if none given)\n");
+	fprintf(stderr, "  --out-dir : Batch mode, mirror the input paths below this directory\n");
+	fprintf(stderr, "  --cache : Batch mode, serve unchanged inputs from converted HTML kept in this directory\n");
+	fprintf(stderr, "  --cache-size : Bound on the cache size in MB, least recently used entries are evicted (default 256)\n");
+	fprintf(stderr, "  --cache-link : Hard-link cached HTML into place instead of copying it\n");
+	fprintf(stderr, "  --arena-size : Batch and server modes, first block of each worker's scratch arena in KB (default %u); the batch summary\n"
+				    "                 and the server report give the high water mark to size it from\n", ARENA_DEFAULT_BLOCK_SIZE / 1024);
+	fprintf(stderr, "  --serve : Stay up and convert sources sent to this Unix socket, on -j workers (default %d), until Ctrl-C\n", SERVER_DEFAULT_WORKERS);
+	fprintf(stderr, "  --connect : Have the server on this Unix socket convert the file instead of converting it here\n");
+	fprintf(stderr, "  --server-report : With --connect, print the server's request counts and latency percentiles as JSON\n");
+	fprintf(stderr, "Example : ./a.out abc.c\n");
+	fprintf(stderr, "Example : ./a.out abc.c output\n");
+	fprintf(stderr, "Example : ./a.out abc.c -n\n");
+	fprintf(stderr, "Example : ./a.out abc.c output -n\n");
+	fprintf(stderr, "Example : ./a.out sqlite3.c -n -p 8\n");
+	fprintf(stderr, "Example : ./a.out abc.c -n --embed-css\n");
+	fprintf(stderr, "Example : ./a.out abc.c --compact --embed-css\n");
+	fprintf(stderr, "Example : ./a.out huge.c -n --page-lines 5000\n");
+	fprintf(stderr, "Example : ./a.out huge.c -n --line-index\n");
+	fprintf(stderr, "Example : ./a.out abc.c -n --incremental\n");
+	fprintf(stderr, "Example : ./a.out abc.c -n --lexer=dfa\n");
+	fprintf(stderr, "Example : cat abc.c | ./a.out - -o abc.html\n");
+	fprintf(stderr, "Example : ./a.out -j 8 --out-dir html src/*.c\n");
+	fprintf(stderr, "Example : ./a.out -j 8 --out-dir html --cache .s2html-cache src/*.c\n");
+	fprintf(stderr, "Example : find src -name '*.c' | ./a.out -j 8 --out-dir html\n");
+	fprintf(stderr, "Example : ./a.out -j 8 --out-dir html --arena-size 4096 src/*.c\n");
+	fprintf(stderr, "Example : ./a.out --serve /tmp/s2html.sock -j 8\n");
+	fprintf(stderr, "Example : ./a.out --connect /tmp/s2html.sock abc.c -n\n\n");
+}
+
+/* Batch mode: converts every file, reporting failures without stopping */
+static int run_batch_mode(char **input_files, int file_count, int worker_count, const char *output_directory, int options,
+						  const char *cache_directory, unsigned long long cache_size, int cache_link, size_t arena_size)
+{
+	batch_config_t config;
+	batch_result_t result;
+	conversion_cache_t cache;
+	char **listed_files = NULL;
+
+	if (file_count == 0) /* no files on the command line => read the list from stdin */
+	{
+		if (NULL == (listed_files = read_file_list(stdin, &file_count)))
+		{
+			fprintf(stderr, "Error! could not read the file list\n");
+			return 2;
+		}
+		input_files = listed_files;
+	}
+	if (cache_directory && !open_conversion_cache(&cache, cache_directory, cache_size, cache_link))
+	{
+		fprintf(stderr, "Error! could not open the cache directory %s\n", cache_directory);
+		if (listed_files)
+			free_file_list(listed_files, file_count);
+		return 2;
+	}
+
+	config.input_files = input_files;
+	config.file_count = file_count;
+	config.worker_count = worker_count;
+	config.output_directory = output_directory;
+	config.options = options;
+	config.cache = cache_directory ? &cache : NULL;
+	config.arena_size = arena_size;
+	result = run_batch(&config);
+
+	printf("\nConverted %d of %d files", result.converted, file_count);
+	if (result.failed)
+	{
+		printf(", %d failed", result.failed);
+	}
+	printf("\n");
+	printf("Scratch arena: %zu KB high water per file, %zu KB held per worker at most\n", (result.arena_high_water + 1023) / 1024,
+		   result.arena_reserved / 1024);
+	if (cache_directory)
+	{
+		printf("Cache: %lu hits, %lu misses, %lu evicted (%llu bytes), %llu bytes in use\n", cache.stats.hits, cache.stats.misses,
+			   cache.stats.evictions, cache.stats.evicted_bytes, cache.total_bytes);
+		close_conversion_cache(&cache);
+	}
+
+	if (listed_files)
+		free_file_list(listed_files, file_count);
+	return result.failed ? 4 : 0;
+}
+
+/* Incremental mode: converts one file, splicing the previous output where the source did not change */
+static int run_incremental_mode(const char *input_path, const char *output_path, int enable_line_numbers)
+{
+	incremental_result_t result;
+	const char *error;
+
+	if ((error = convert_file_incremental(input_path, output_path, enable_line_numbers, &result)) != NULL)
+	{
+		fprintf(stderr, "Error! %s: %s\n", input_path, error);
+		return 3;
+	}
+
+	printf("\nOutput file %s generated", output_path);
+	if (result.reused && result.relexed_lines == 0)
+		printf(", source unchanged");
+	else if (result.reused)
+		printf(", re-lexed %zu of %zu lines from line %zu", result.relexed_lines, result.line_count, result.first_relexed_line);
+	printf("\n");
+	return 0;
+}
+
+/* Paged mode: converts source into pages of page_lines lines and an index of them at output_path */
+static int run_paged_mode(source_buffer_t *source, const char *output_path, int options, int page_lines)
+{
+	paged_result_t result;
+	const char *error;
+
+	if ((error = convert_source_paged(source, output_path, options, page_lines, &result)) != NULL)
+	{
+		fprintf(stderr, "Error! %s: %s\n", output_path, error);
+		return 3;
+	}
+
+	printf("\nOutput file %s generated, %d lines in %d pages\n", output_path, result.line_count, result.page_count);
+	return 0;
+}
+
+/* Server mode: converts sources sent to socket_path until a stop signal, then prints the totals */
+static int run_server_mode(const char *socket_path, int worker_count, size_t arena_size)
+{
+	server_stats_t total;
+	output_buffer_t report;
+	const char *error;
+
+	if ((error = run_server(socket_path, worker_count, arena_size, &total)) != NULL)
+	{
+		fprintf(stderr, "Error! %s: %s\n", socket_path, error);
+		return 3;
+	}
+	if (open_output_buffer(&report, stdout))
+	{
+		append_server_report(&report, &total);
+		close_output_buffer(&report);
+	}
+	return 0;
+}
+
+/* Client mode: has the server at socket_path convert input_path (or print its report when input_path is NULL) */
+static int run_client_mode(const char *socket_path, const char *input_path, const char *output_path, int options)
+{
+	source_buffer_t source;
+	output_buffer_t request, response;
+	FILE *destination_stream;
+	const char *error;
+	char chunk[OUTPUT_BUFFER_SIZE];
+	int write_stdout = output_path == NULL || strcmp(output_path, "-") == 0;
+	int status = 0;
+	size_t count;
+
+	if (!open_memory_output_buffer(&request) || !open_memory_output_buffer(&response))
+	{
+		fprintf(stderr, "Error! out of memory\n");
+		return 1;
+	}
+
+	/* The request needs the whole source up front, so stdin is read to its end first */
+	if (input_path && strcmp(input_path, "-") == 0)
+	{
+		while ((count = fread(chunk, 1, sizeof(chunk), stdin)) > 0)
+			output_append(&request, chunk, count);
+	}
+	else if (input_path)
+	{
+		if (!open_source_buffer(&source, input_path))
+		{
+			fprintf(stderr, "Error! File %s could not be opened\n", input_path);
+			close_output_buffer(&request);
+			close_output_buffer(&response);
+			return 2;
+		}
+		output_append(&request, source.data, source.length);
+		close_source_buffer(&source);
+	}
+
+	if (request.error)
+		error = "out of memory";
+	else
+		error = request_conversion(socket_path, input_path ? (unsigned int)options : SERVER_REQUEST_REPORT, request.data, request.length, &response);
+	if (error)
+	{
+		fprintf(stderr, "Error! %s: %s%s%.*s\n", socket_path, error, response.length ? ": " : "", (int)response.length, response.data);
+		status = 3;
+	}
+	else if (NULL == (destination_stream = write_stdout ? stdout : fopen(output_path, "w")))
+	{
+		fprintf(stderr, "Error! could not create %s output file\n", output_path);
+		status = 3;
+	}
+	else
+	{
+		count = fwrite(response.data, 1, response.length, destination_stream);
+		if ((write_stdout ? fflush(destination_stream) : fclose(destination_stream)) != 0 || count != response.length)
+		{
+			fprintf(stderr, "Error! could not write %s output file\n", output_path);
+			status = 3;
+		}
+		else if (!write_stdout)
+		{
+			printf("\nOutput file %s generated by %s\n", output_path, socket_path);
+		}
+	}
+	close_output_buffer(&request);
+	close_output_buffer(&response);
+	return status;
+}
 
 /********** main program entry point **********/
 
 int main(int argc, char *argv[])
 {
-	FILE *source_stream, *destination_stream; // input and output file handles
-	parser_token_t *parsed_token;
-	char output_filename[100];
+	source_buffer_t source;			/* input file bytes */
+	FILE *destination_stream;		/* output file handle */
+	output_buffer_t destination;	/* buffered writer in front of destination_stream */
+	char output_filename[PATH_MAX];
+	char *input_path;				/* single mode source, "-" for stdin */
+	char *output_path = NULL;		/* exact output path given with -o */
+	char *output_name = NULL;		/* legacy output name, ".html" gets appended */
+	char **positional;				/* non-option arguments in order */
+	char *output_directory = NULL;	/* batch mode: --out-dir */
+	char *cache_directory = NULL;	/* batch mode: --cache, NULL => no conversion cache */
+	unsigned long long cache_size = 0;	/* batch mode: --cache-size in MB, 0 => default bound */
+	int cache_link = 0;				/* batch mode: --cache-link, hard-link cached HTML instead of copying */
+	size_t arena_size = 0;			/* batch and server modes: --arena-size in KB, 0 => ARENA_DEFAULT_BLOCK_SIZE */
+	int positional_count = 0;
+	int worker_count = 0;			/* batch mode: -j, 0 => single file mode */
+	int thread_count = 1;			/* single mode: -p, chunks of the file lexed in parallel */
+	parallel_result_t parallel_result;
+	int batch_mode = 0;
+	int incremental = 0;			/* single mode: --incremental, reuse the previous output where the source is unchanged */
+	int stats_format = 0;			/* single mode: --stats, 1 => table, 2 => JSON, printed on stderr */
+	s2html_stats_t stats;
 	int enable_line_numbers = 0; /* Flag for line numbering */
+	int embed_css = 0;				/* --embed-css, inline the used theme rules instead of linking styles.css */
+	int compact = 0;				/* --compact, short class names and merged spans */
+	int page_lines = 0;				/* single mode: --page-lines, 0 => one document */
+	int dfa_lexer = 0;				/* --lexer=dfa, tokens from the generated transition table */
+	int index_format = 0;			/* single mode: --line-index, 1 => binary, 2 => JSON, written next to the HTML */
+	char *serve_path = NULL;		/* --serve, socket to take conversion requests on */
+	char *connect_path = NULL;		/* --connect, socket of the server that converts instead */
+	int server_report = 0;			/* --server-report, ask the --connect server for its report */
+	line_index_t line_index;
+	char index_path[LINE_INDEX_PATH_LENGTH];
+	const char *error;
+	int options;					/* CONVERT_* flags handed to the conversions */
+	int read_stdin, write_stdout, status;
 	int i;
 
 	/* Validate command line arguments */
 	if (argc < 2)
 	{
-		printf("\nError ! please enter file name and mode\n");
-		printf("Usage: <executable> <file name> [output name] [-n]\n");
-		printf("  -n : Enable line numbers\n");
-		printf("Example : ./a.out abc.c\n");
-		printf("Example : ./a.out abc.c output\n");
-		printf("Example : ./a.out abc.c -n\n");
-		printf("Example : ./a.out abc.c output -n\n\n");
+		print_usage();
 		return 1;
 	}
 
-#ifdef DEBUG
-	printf("File to be opened : %s\n", argv[1]);
-#endif
-
 	/* Parse command line options */
-	for (i = 2; i < argc; i++)
+	if (NULL == (positional = malloc(argc * sizeof(*positional))))
+	{
+		fprintf(stderr, "Error! out of memory\n");
+		return 1;
+	}
+	for (i = 1; i < argc; i++)
 	{
 		if (strcmp(argv[i], "-n") == 0)
 		{
 			enable_line_numbers = 1;
 #ifdef DEBUG
-			printf("Line numbering enabled\n");
+			fprintf(stderr, "Line numbering enabled\n");
 #endif
 		}
+		else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+		{
+			output_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+		{
+			thread_count = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--embed-css") == 0)
+		{
+			embed_css = 1;
+		}
+		else if (strcmp(argv[i], "--compact") == 0)
+		{
+			compact = 1;
+		}
+		else if (strcmp(argv[i], "--page-lines") == 0 && i + 1 < argc)
+		{
+			page_lines = atoi(argv[++i]);
+			if (page_lines <= 0)
+			{
+				fprintf(stderr, "Error! --page-lines needs a positive number of lines\n");
+				free(positional);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--line-index") == 0)
+		{
+			index_format = 1;
+		}
+		else if (strcmp(argv[i], "--line-index=json") == 0)
+		{
+			index_format = 2;
+		}
+		else if (strcmp(argv[i], "--stats") == 0 || strcmp(argv[i], "--stats=table") == 0)
+		{
+			stats_format = 1;
+		}
+		else if (strcmp(argv[i], "--stats=json") == 0)
+		{
+			stats_format = 2;
+		}
+		else if (strcmp(argv[i], "--incremental") == 0)
+		{
+			incremental = 1;
+		}
+		else if (strcmp(argv[i], "--lexer=dfa") == 0 || strcmp(argv[i], "--lexer=handlers") == 0)
+		{
+			dfa_lexer = strcmp(argv[i], "--lexer=dfa") == 0;
+		}
+		else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+		{
+			worker_count = atoi(argv[++i]);
+			batch_mode = 1;
+		}
+		else if (strcmp(argv[i], "--out-dir") == 0 && i + 1 < argc)
+		{
+			output_directory = argv[++i];
+			batch_mode = 1;
+		}
+		else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc)
+		{
+			cache_directory = argv[++i];
+			batch_mode = 1;
+		}
+		else if (strcmp(argv[i], "--cache-size") == 0 && i + 1 < argc)
+		{
+			cache_size = strtoull(argv[++i], NULL, 10) * 1024 * 1024;
+		}
+		else if (strcmp(argv[i], "--cache-link") == 0)
+		{
+			cache_link = 1;
+		}
+		else if (strcmp(argv[i], "--arena-size") == 0 && i + 1 < argc)
+		{
+			arena_size = (size_t)strtoull(argv[++i], NULL, 10) * 1024;
+		}
+		else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc)
+		{
+			serve_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--connect") == 0 && i + 1 < argc)
+		{
+			connect_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--server-report") == 0)
+		{
+			server_report = 1;
+		}
+		else if (argv[i][0] == '-' && argv[i][1] != '\0') /* "-" alone is stdin */
+		{
+			fprintf(stderr, "Error! unknown option %s, or its value is missing\n\n", argv[i]);
+			free(positional);
+			print_usage();
+			return 1;
+		}
+		else
+		{
+			positional[positional_count++] = argv[i];
+		}
 	}
 
-	/* Open source file for reading */
-	if (NULL == (source_stream = fopen(argv[1], "r")))
+	options = (enable_line_numbers ? CONVERT_LINE_NUMBERS : 0) | (embed_css ? CONVERT_EMBED_CSS : 0) | (compact ? CONVERT_COMPACT : 0) |
+			  (dfa_lexer ? CONVERT_DFA_LEXER : 0);
+	if (dfa_lexer && (serve_path || connect_path || incremental || stats_format || thread_count > 1))
 	{
-		printf("Error! File %s could not be opened\n", argv[1]);
-		return 2;
+		fprintf(stderr, "Error! --lexer=dfa cannot be combined with --serve, --connect, --incremental, --stats or -p\n");
+		free(positional);
+		return 1;
 	}
-	
+	if (serve_path || (connect_path && server_report))
+	{
+		if (positional_count > 0)
+		{
+			fprintf(stderr, "Error! unexpected argument %s, --serve and --server-report take no files\n", positional[0]);
+			free(positional);
+			return 1;
+		}
+		free(positional);
+		return serve_path ? run_server_mode(serve_path, worker_count, arena_size) : run_client_mode(connect_path, NULL, NULL, 0);
+	}
+	if (batch_mode)
+	{
+		if (output_path || thread_count != 1 || page_lines || index_format || incremental || stats_format)
+		{
+			fprintf(stderr, "Error! %s only applies to a single file, not to batch mode (-j, --out-dir, --cache)\n\n", output_path ? "-o" :
+					thread_count != 1 ? "-p" : page_lines ? "--page-lines" : index_format ? "--line-index" : incremental ? "--incremental" : "--stats");
+			free(positional);
+			print_usage();
+			return 1;
+		}
+		if ((cache_size || cache_link) && !cache_directory)
+		{
+			fprintf(stderr, "Error! %s needs --cache\n\n", cache_size ? "--cache-size" : "--cache-link");
+			free(positional);
+			print_usage();
+			return 1;
+		}
+		status = run_batch_mode(positional, positional_count, worker_count, output_directory, options,
+								cache_directory, cache_size, cache_link, arena_size);
+		free(positional);
+		return status;
+	}
+	if (positional_count == 0)
+	{
+		free(positional);
+		print_usage();
+		return 1;
+	}
+	if (cache_size || cache_link || arena_size)
+	{
+		fprintf(stderr, "Error! %s is for batch mode (-j, --out-dir, --cache)%s\n\n", cache_size ? "--cache-size" : cache_link ? "--cache-link" :
+				"--arena-size", cache_size || cache_link ? "" : " and --serve");
+		free(positional);
+		print_usage();
+		return 1;
+	}
+	if (positional_count > 2) /* an input and the legacy output name at most */
+	{
+		fprintf(stderr, "Error! unexpected argument %s, give -j to convert several files\n\n", positional[2]);
+		free(positional);
+		print_usage();
+		return 1;
+	}
+	input_path = positional[0];
+	if (positional_count > 1)
+		output_name = positional[1];
+	free(positional);
+
+#ifdef DEBUG
+	fprintf(stderr, "File to be opened : %s\n", input_path);
+#endif
+
 	/* Determine output filename */
-	if (argc > 2 && strcmp(argv[2], "-n") != 0)
+	read_stdin = strcmp(input_path, "-") == 0;
+	if (output_path == NULL)
 	{
-		sprintf(output_filename, "%s.html", argv[2]);
+		output_path = (read_stdin && output_name == NULL) ? "-" : output_filename;
+		if (output_path == output_filename && snprintf(output_filename, sizeof(output_filename), "%s.html",
+													   output_name ? output_name : input_path) >= (int)sizeof(output_filename))
+		{
+			fprintf(stderr, "Error! output path too long\n");
+			return 1;
+		}
 	}
-	else
+	write_stdout = strcmp(output_path, "-") == 0;
+
+#ifndef S2HTML_STATS
+	if (stats_format)
 	{
-		sprintf(output_filename, "%s.html", argv[1]);
+		fprintf(stderr, "Error! --stats needs a build with -DS2HTML_STATS\n");
+		return 1;
+	}
+#endif
+
+	if (connect_path)
+	{
+		if (incremental || page_lines || index_format || stats_format)
+		{
+			fprintf(stderr, "Error! --connect cannot be combined with --incremental, --page-lines, --line-index or --stats\n");
+			return 1;
+		}
+		return run_client_mode(connect_path, input_path, output_path, options);
+	}
+
+	if (incremental)
+	{
+		if (read_stdin || write_stdout)
+		{
+			fprintf(stderr, "Error! --incremental needs an input file and an output file\n");
+			return 1;
+		}
+		if (embed_css || compact || page_lines || index_format)
+		{
+			fprintf(stderr, "Error! --incremental cannot be combined with %s\n", embed_css ? "--embed-css" : compact ? "--compact" :
+							    page_lines ? "--page-lines" : "--line-index");
+			return 1;
+		}
+		return run_incremental_mode(input_path, output_path, enable_line_numbers);
+	}
+
+	if (page_lines && (write_stdout || stats_format))
+	{
+		fprintf(stderr, "Error! --page-lines needs an output file and cannot be combined with --stats\n");
+		return 1;
+	}
+	if (index_format && (write_stdout || stats_format || page_lines))
+	{
+		fprintf(stderr, "Error! --line-index needs an output file and cannot be combined with --stats or --page-lines\n");
+		return 1;
+	}
+	if (index_format && snprintf(index_path, sizeof(index_path), "%s%s", output_path,
+								 index_format == 2 ? LINE_INDEX_JSON_SUFFIX : LINE_INDEX_SUFFIX) >= (int)sizeof(index_path))
+	{
+		fprintf(stderr, "Error! output path too long\n");
+		return 1;
+	}
+
+	/* Open source file for reading; stdin is streamed, so an embedded theme cannot wait for the classes the body uses */
+	if (read_stdin && embed_css)
+		options |= CONVERT_FULL_THEME;
+	if (!(read_stdin ? open_source_stream(&source, stdin) : open_source_buffer(&source, input_path)))
+	{
+		fprintf(stderr, "Error! File %s could not be opened\n", input_path);
+		return 2;
+	}
+
+	/* Pages are written while the source streams in, so stdin works as well as a file */
+	if (page_lines)
+	{
+		status = run_paged_mode(&source, output_path, options, page_lines);
+		close_source_buffer(&source);
+		return status;
 	}
 	
 	/* Create destination file for writing */
-	if (NULL == (destination_stream = fopen(output_filename, "w")))
+	if (NULL == (destination_stream = write_stdout ? stdout : fopen(output_path, "w")))
 	{
-		printf("Error! could not create %s output file\n", output_filename);
+		fprintf(stderr, "Error! could not create %s output file\n", output_path);
+		close_source_buffer(&source);
 		return 3;
 	}
 
-	/* Generate HTML document header */
-	generate_html_header(destination_stream, HTML_DOCUMENT_START);
+	if (!open_output_buffer(&destination, destination_stream))
+	{
+		fprintf(stderr, "Error! could not allocate output buffer\n");
+		close_source_buffer(&source);
+		return 3;
+	}
+
+	/* Parse source file and convert tokens to HTML; counted and indexed conversions always run on one thread */
+	if (stats_format)
+	{
+		init_stats(&stats);
+		convert_source_to_html_counted(&source, &destination, options, &stats);
+	}
+	else if (index_format)
+	{
+		init_line_index(&line_index);
+		convert_source_to_html_indexed(&source, &destination, options, &line_index);
+	}
+	else if (thread_count > 1)
+	{
+		convert_source_parallel(&source, &destination, options, thread_count, &parallel_result);
+#ifdef DEBUG
+		fprintf(stderr, "Lexed in %d chunks, %d re-lexed\n", parallel_result.chunk_count, parallel_result.relexed_count);
+#endif
+	}
+	else
+	{
+		convert_source_to_html(&source, &destination, options);
+	}
+	if (source.error)
+	{
+		fprintf(stderr, "Error! could not read all of %s\n", read_stdin ? "stdin" : input_path);
+		close_output_buffer(&destination);
+		close_source_buffer(&source);
+		if (!write_stdout)
+			fclose(destination_stream);
+		return 2;
+	}
+	if (!close_output_buffer(&destination))
+	{
+		fprintf(stderr, "Error! could not write %s output file\n", output_path);
+		close_source_buffer(&source);
+		if (!write_stdout)
+			fclose(destination_stream);
+		return 3;
+	}
 
-	/* Parse source file and convert tokens to HTML */
-	do
+	if (stats_format)
+		print_stats(stderr, &stats, stats_format == 2);
+	if (index_format)
 	{
-		parsed_token = extract_next_token(source_stream);
-		/* Convert each token to appropriate HTML markup */
-		convert_token_to_html(destination_stream, parsed_token, enable_line_numbers);
-	} while (parsed_token->type != TOKEN_END_OF_FILE);
+		error = save_line_index(index_path, &line_index, options & ~CONVERT_ENGINE_FLAGS, index_format == 2); /* the options of the HTML */
+		free_line_index(&line_index);
+		if (error)
+		{
+			fprintf(stderr, "Error! %s: %s\n", index_path, error);
+			close_source_buffer(&source);
+			fclose(destination_stream);
+			return 3;
+		}
+	}
 
-	/* Generate HTML document footer */
-	generate_html_footer(destination_stream, HTML_DOCUMENT_END);
+	/* Clean up file resources */
+	close_source_buffer(&source);
+	if (write_stdout)
+	{
+		fflush(destination_stream);
+		return 0;
+	}
+	fclose(destination_stream);
 
-	printf("\nOutput file %s generated", output_filename);
+	printf("\nOutput file %s generated", output_path);
 	if (enable_line_numbers)
 	{
 		printf(" with line numbers");
 	}
+	if (index_format)
+	{
+		printf(", line index %s", index_path);
+	}
 	printf("\n");
-	
-	/* Clean up file resources */
-	fclose(source_stream);
-	fclose(destination_stream);
 
 	return 0;
 }
\ No newline at end of file
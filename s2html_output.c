@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "s2html_output.h"
+#include "s2html_arena.h"
+
+/* Prepares an append-only buffer in front of output_stream; returns 1 on success, 0 on failure */
+int open_output_buffer(output_buffer_t *output, FILE *output_stream)
+{
+	memset(output, 0, sizeof(*output));
+	if (NULL == (output->data = malloc(OUTPUT_BUFFER_SIZE)))
+		return 0;
+	output->stream = output_stream;
+	output->capacity = OUTPUT_BUFFER_SIZE;
+	return 1;
+}
+
+/* Prepares a buffer that keeps everything appended to it in memory; returns 1 on success, 0 on failure */
+int open_memory_output_buffer(output_buffer_t *output)
+{
+	return open_output_buffer(output, NULL);
+}
+
+/* Prepares a memory buffer that writes into capacity bytes at buffer and never allocates; when they are not enough
+   the buffer reports an error and overflow counts the bytes that were missing */
+void open_fixed_output_buffer(output_buffer_t *output, char *buffer, size_t capacity)
+{
+	memset(output, 0, sizeof(*output));
+	output->data = buffer;
+	output->capacity = capacity;
+	output->fixed = 1;
+}
+
+/* Same as open_output_buffer (NULL stream => memory buffer), with the storage taken from arena instead of malloc: it
+   stays valid until the arena is reset, so the caller can keep reading a memory buffer after closing it */
+int open_arena_output_buffer(output_buffer_t *output, FILE *output_stream, struct s2html_arena *arena)
+{
+	memset(output, 0, sizeof(*output));
+	if (NULL == (output->data = arena_alloc(arena, OUTPUT_BUFFER_SIZE)))
+		return 0;
+	output->stream = output_stream;
+	output->capacity = OUTPUT_BUFFER_SIZE;
+	output->arena = arena;
+	return 1;
+}
+
+/* Writes all pending bytes in one fwrite (memory buffers keep them); returns 1 on success, 0 on write error */
+int flush_output_buffer(output_buffer_t *output)
+{
+	size_t count = output->length;
+
+	if (output->stream == NULL)
+		return !output->error;
+	output->length = 0;
+	if (count == 0)
+		return !output->error;
+	output->bytes_written += count;
+	if (fwrite(output->data, 1, count, output->stream) != count)
+		output->error = 1;
+	return !output->error;
+}
+
+/* Flushes and releases the buffer (the stream stays open for its owner); returns 1 on success */
+int close_output_buffer(output_buffer_t *output)
+{
+	int status = flush_output_buffer(output);
+
+	if (!output->fixed && output->arena == NULL)
+		free(output->data);
+	memset(output, 0, sizeof(*output));
+	return status;
+}
+
+/* Slow path of output_append: text does not fit in the remaining space */
+void output_append_slow(output_buffer_t *output, const char *text, size_t length)
+{
+	size_t capacity;
+	char *grown;
+
+	if (output->fixed) /* caller storage: keep counting what the whole output needs */
+	{
+		output->overflow += length;
+		output->error = 1;
+		return;
+	}
+	if (output->stream == NULL) /* memory buffer: grow geometrically */
+	{
+		for (capacity = output->capacity; capacity - output->length < length; capacity *= 2)
+			;
+		if (output->arena)
+			grown = arena_grow(output->arena, output->data, output->length, capacity);
+		else
+			grown = realloc(output->data, capacity);
+		if (grown == NULL)
+		{
+			output->error = 1;
+			return;
+		}
+		output->data = grown;
+		output->capacity = capacity;
+		memcpy(output->data + output->length, text, length);
+		output->length += length;
+		return;
+	}
+
+	flush_output_buffer(output);
+	if (length >= output->capacity) /* too large to be worth copying */
+	{
+		output->bytes_written += length;
+		if (fwrite(text, 1, length, output->stream) != length)
+			output->error = 1;
+		return;
+	}
+	memcpy(output->data, text, length);
+	output->length = length;
+}
@@ -0,0 +1,62 @@
+#ifndef S2HTML_OUTPUT_H
+#define S2HTML_OUTPUT_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+
+#define OUTPUT_BUFFER_SIZE		65536
+
+/* Expands a string literal to "pointer, length" arguments */
+#define OUTPUT_LITERAL(text)	text, (sizeof(text) - 1)
+
+typedef struct
+{
+	FILE *stream;			// destination, written with fwrite on flush; NULL => memory buffer that grows instead
+	int fixed;				// memory buffer in caller storage: never grown or freed, bytes that do not fit go to overflow
+	size_t overflow;		// fixed buffers only: bytes dropped because data was full
+	struct s2html_arena *arena;	// non-NULL => data is cut from this arena, grown in it and released by its reset
+	char *data;				// pending bytes
+	size_t length;			// number of pending bytes
+	size_t capacity;		// size of data
+	size_t bytes_written;	// total bytes flushed so far
+	int error;				// set once a write or an allocation failed
+}output_buffer_t;
+
+/********** function prototypes **********/
+
+int open_output_buffer(output_buffer_t *output, FILE *output_stream);
+int open_memory_output_buffer(output_buffer_t *output);
+void open_fixed_output_buffer(output_buffer_t *output, char *buffer, size_t capacity);
+int open_arena_output_buffer(output_buffer_t *output, FILE *output_stream, struct s2html_arena *arena);
+int flush_output_buffer(output_buffer_t *output);
+int close_output_buffer(output_buffer_t *output);
+void output_append_slow(output_buffer_t *output, const char *text, size_t length);
+
+/********** append helpers **********/
+
+/* Appends length bytes of text */
+static inline void output_append(output_buffer_t *output, const char *text, size_t length)
+{
+	if (length <= output->capacity - output->length)
+	{
+		memcpy(output->data + output->length, text, length);
+		output->length += length;
+		return;
+	}
+	output_append_slow(output, text, length);
+}
+
+/* Appends a single byte */
+static inline void output_append_char(output_buffer_t *output, char character)
+{
+	if (output->length == output->capacity)
+	{
+		output_append_slow(output, &character, 1);
+		return;
+	}
+	output->data[output->length++] = character;
+}
+
+#endif
+/**** End of file ****/
@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "s2html_event.h"
+#include "s2html_conv.h"
+#include "s2html_pages.h"
+
+#define PAGE_NAME_FORMAT		"%s.page%d.html"
+
+/*
+ * Paged output: the document is cut into pages of page_lines source lines while the lexer streams, so no page waits
+ * for the rest of the file. The emitter asks for a page break before the first byte of every page_lines + 1st line;
+ * the page written so far gets its own header and footer and is renamed into place complete, and a span that runs
+ * over the break is closed on one page and opened again on the next. All pages share one emitter, so line numbers
+ * and their L<line> anchors continue across pages. <output> becomes an index of the pages, written last.
+ */
+
+typedef struct
+{
+	char stem[PAGE_PATH_LENGTH];	// output path without its ".html", pages are <stem>.page<n>.html
+	int options;					// CONVERT_* flags of every page
+	int page_lines;					// source lines per page
+	output_buffer_t body;			// HTML of the page being lexed, without header and footer
+	int page_count;					// pages written
+	const char *error;				// first failure; later pages are lexed but not written
+}page_writer_t;
+
+/********** Helper function implementations **********/
+
+/* Writes a complete HTML file through a temporary file renamed over path, so readers never see part of it; the
+   header of a document with used_classes goes first and body in the middle */
+static const char *write_html_file(const char *path, int options, unsigned int used_classes, const output_buffer_t *body)
+{
+	char temporary_path[PAGE_PATH_LENGTH];
+	output_buffer_t destination;
+	s2html_emitter_t frame;
+	FILE *destination_stream;
+	const char *error = NULL;
+
+	if (snprintf(temporary_path, sizeof(temporary_path), "%s.tmp", path) >= (int)sizeof(temporary_path))
+		return "output path too long";
+	if (NULL == (destination_stream = fopen(temporary_path, "w")))
+		return "could not create output file";
+	if (!open_output_buffer(&destination, destination_stream))
+	{
+		fclose(destination_stream);
+		remove(temporary_path);
+		return "could not allocate output buffer";
+	}
+
+	/* A separate emitter, the one lexing the page must keep its line counter */
+	init_emitter(&frame, &destination, options);
+	frame.used_classes = used_classes;
+	generate_html_header(&frame, HTML_DOCUMENT_START);
+	output_append(&destination, body->data, body->length);
+	generate_html_footer(&frame, HTML_DOCUMENT_END);
+
+	if (!close_output_buffer(&destination) || body->error)
+		error = "could not write output file";
+	if (fclose(destination_stream) != 0 && error == NULL)
+		error = "could not write output file";
+	if (error == NULL && rename(temporary_path, path) != 0)
+		error = "could not replace output file";
+	if (error)
+		remove(temporary_path);
+	return error;
+}
+
+/* Writes the page lexed so far as the next page file */
+static void complete_page(page_writer_t *writer, unsigned int used_classes)
+{
+	char path[PAGE_PATH_LENGTH];
+
+	writer->page_count++;
+	if (writer->error)
+		return;
+	if (snprintf(path, sizeof(path), PAGE_NAME_FORMAT, writer->stem, writer->page_count) >= (int)sizeof(path))
+		writer->error = "output path too long";
+	else
+		writer->error = write_html_file(path, writer->options, used_classes, &writer->body);
+}
+
+/* Emitter page_break: completes the page and starts the next one empty */
+static void break_page_at_line(s2html_emitter_t *emitter)
+{
+	page_writer_t *writer = emitter->page_context;
+
+	complete_page(writer, emitter->used_classes);
+	writer->body.length = 0;
+	emitter->used_classes = 0;
+	emitter->next_page_line += writer->page_lines;
+}
+
+/* Appends text with the characters HTML gives a meaning escaped */
+static void append_escaped(output_buffer_t *output, const char *text)
+{
+	for (; *text; text++)
+	{
+		if (*text == '&')
+			output_append(output, OUTPUT_LITERAL("&amp;"));
+		else if (*text == '<')
+			output_append(output, OUTPUT_LITERAL("&lt;"));
+		else if (*text == '"')
+			output_append(output, OUTPUT_LITERAL("&quot;"));
+		else
+			output_append_char(output, *text);
+	}
+}
+
+/* Writes output_path as a list of links to the pages, with the lines each one holds */
+static const char *write_page_index(const page_writer_t *writer, const char *output_path, int line_count)
+{
+	char name[PAGE_PATH_LENGTH + 32], range[64];
+	const char *base_name = strrchr(writer->stem, '/') ? strrchr(writer->stem, '/') + 1 : writer->stem;
+	output_buffer_t index;
+	FILE *index_stream;
+	const char *error = NULL;
+	char temporary_path[PAGE_PATH_LENGTH];
+	int page, first_line, last_line;
+
+	if (snprintf(temporary_path, sizeof(temporary_path), "%s.tmp", output_path) >= (int)sizeof(temporary_path))
+		return "output path too long";
+	if (NULL == (index_stream = fopen(temporary_path, "w")))
+		return "could not create output file";
+	if (!open_output_buffer(&index, index_stream))
+	{
+		fclose(index_stream);
+		remove(temporary_path);
+		return "could not allocate output buffer";
+	}
+
+	output_append(&index, OUTPUT_LITERAL("<!DOCTYPE html>\n"
+										 "<html lang=\"en-US\">\n"
+										 "<head>\n"
+										 "<title>sode2html</title>\n"
+										 "<meta charset=\"UTF-8\">\n"
+										 "</head>\n"
+										 "<body>\n"
+										 "<ul>\n"));
+	for (page = 1; page <= writer->page_count; page++)
+	{
+		first_line = (page - 1) * writer->page_lines + 1;
+		last_line = page == writer->page_count ? line_count : page * writer->page_lines;
+		snprintf(name, sizeof(name), PAGE_NAME_FORMAT, base_name, page);
+		output_append(&index, OUTPUT_LITERAL("<li><a href=\""));
+		append_escaped(&index, name);
+		output_append(&index, OUTPUT_LITERAL("\">"));
+		output_append(&index, range, snprintf(range, sizeof(range), "Lines %d - %d", first_line, last_line));
+		output_append(&index, OUTPUT_LITERAL("</a></li>\n"));
+	}
+	output_append(&index, OUTPUT_LITERAL("</ul>\n"
+										 "</body>\n"
+										 "</html>\n"));
+
+	if (!close_output_buffer(&index))
+		error = "could not write output file";
+	if (fclose(index_stream) != 0 && error == NULL)
+		error = "could not write output file";
+	if (error == NULL && rename(temporary_path, output_path) != 0)
+		error = "could not replace output file";
+	if (error)
+		remove(temporary_path);
+	return error;
+}
+
+/* ********************************************************************************************************************** */
+/* ********************************************************************************************************************** */
+
+/* Converts source into pages of page_lines lines next to output_path and an index of them at output_path; returns
+   NULL on success or a description of the failure */
+const char *convert_source_paged(source_buffer_t *source, const char *output_path, int options, int page_lines, paged_result_t *result)
+{
+	page_writer_t writer;
+	s2html_lexer_t lexer;
+	s2html_emitter_t emitter;
+	parser_token_t *token;
+	size_t stem_length = strlen(output_path);
+
+	memset(result, 0, sizeof(*result));
+	if (page_lines <= 0 || page_lines > PAGE_MAX_LINES)
+		return "page size out of range";
+	if (stem_length > 5 && strcmp(output_path + stem_length - 5, ".html") == 0)
+		stem_length -= 5;
+	if (stem_length + 32 > sizeof(writer.stem))
+		return "output path too long";
+	memcpy(writer.stem, output_path, stem_length);
+	writer.stem[stem_length] = '\0';
+	writer.page_lines = page_lines;
+	writer.page_count = 0;
+	writer.error = NULL;
+
+	/* Anchors let the index and other pages link to any line */
+	writer.options = (options & CONVERT_LINE_NUMBERS) ? options | CONVERT_LINE_ANCHORS : options;
+	if (!open_memory_output_buffer(&writer.body))
+		return "could not allocate output buffer";
+
+	init_lexer(&lexer, source);
+	lexer.table_driven = (options & CONVERT_DFA_LEXER) != 0;
+	init_emitter(&emitter, &writer.body, writer.options);
+	emitter.next_page_line = page_lines + 1;
+	emitter.page_break = break_page_at_line;
+	emitter.page_context = &writer;
+	do
+	{
+		token = extract_next_token(&lexer);
+		convert_token_to_html(&emitter, token);
+	} while (token->type != TOKEN_END_OF_FILE);
+	complete_page(&writer, emitter.used_classes);
+	close_output_buffer(&writer.body);
+	if (source->error && writer.error == NULL)
+		writer.error = "could not read the whole source";
+
+	result->page_count = writer.page_count;
+	result->line_count = emitter.current_line_number - (emitter.line_start ? 1 : 0);
+	if (writer.error)
+		return writer.error;
+	return write_page_index(&writer, output_path, result->line_count);
+}
@@ -0,0 +1,18 @@
+#ifndef S2HTML_PAGES_H
+#define S2HTML_PAGES_H
+
+#define PAGE_PATH_LENGTH		4096
+#define PAGE_MAX_LINES			100000000	/* keeps the next page line within an int */
+
+typedef struct
+{
+	int page_count;				// pages written
+	int line_count;				// source lines over all pages
+}paged_result_t;
+
+/********** function prototypes **********/
+
+const char *convert_source_paged(source_buffer_t *source, const char *output_path, int options, int page_lines, paged_result_t *result);
+
+#endif
+/**** End of file ****/
@@ -0,0 +1,382 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "s2html_event.h"
+#include "s2html_conv.h"
+#include "s2html_parallel.h"
+
+#define BOUNDARY_INITIAL_CAPACITY	256
+
+/*
+ * A chunk lexer starts at a line start in the state a fresh lexer has there, which is a guess: the serial lexer may
+ * be inside a comment or string at that point. Each chunk lexer records the token boundaries near its own start
+ * (entries) and near the next chunk's start (exits). Two neighbours are joined at the first exit of the left chunk
+ * that the right chunk also reached in exactly the same state; from there on both produce the same HTML. When no
+ * such boundary exists the right chunk is lexed again from the left chunk's last exit, which is known to be right.
+ *
+ * Line numbers cannot be derived from the bytes in front of a chunk (some directives drop their newline), but the
+ * gutters are numbered consecutively, so chunks only note where theirs go and the join numbers them in order.
+ */
+
+/* Token boundary seen by a chunk lexer: lexer and emitter state, and how much HTML the chunk had written there */
+typedef struct
+{
+	lexer_checkpoint_t lexer_state;
+	int line_start;				// emitter gutter pending
+	unsigned int open_style_bit;	// compact: span the emitter still had open
+	size_t output_offset;		// bytes of chunk HTML written before the boundary
+}chunk_boundary_t;
+
+typedef struct
+{
+	chunk_boundary_t *items;	// in source order
+	int count;
+	int capacity;
+}boundary_list_t;
+
+typedef struct
+{
+	const source_buffer_t *source;	// whole input, shared read only
+	int options;					// CONVERT_* flags
+	chunk_boundary_t entry;			// state the chunk is lexed from, a guess unless the chunk was re-lexed
+	size_t entry_limit;				// boundaries before this offset may join the previous chunk
+	size_t exit_from;				// start of the next chunk: boundaries from here on may join it
+	size_t exit_limit;				// lexing stops at the first boundary at or past this offset
+	output_buffer_t output;			// HTML of the chunk without gutters, kept in memory
+	gutter_marks_t gutters;			// where the gutters of output go
+	boundary_list_t entries;
+	boundary_list_t exits;
+	int reached_end;				// lexing ran into the end of the source
+	int failed;						// out of memory, output and boundaries are incomplete
+	int started;					// thread was created and must be joined
+	pthread_t thread;
+}chunk_worker_t;
+
+/********** Helper function implementations **********/
+
+static int push_boundary(boundary_list_t *list, const chunk_boundary_t *boundary)
+{
+	chunk_boundary_t *grown;
+	int capacity;
+
+	if (list->count == list->capacity)
+	{
+		capacity = list->capacity ? list->capacity * 2 : BOUNDARY_INITIAL_CAPACITY;
+		if (NULL == (grown = realloc(list->items, capacity * sizeof(*grown))))
+			return 0;
+		list->items = grown;
+		list->capacity = capacity;
+	}
+	list->items[list->count++] = *boundary;
+	return 1;
+}
+
+static int boundaries_equal(const chunk_boundary_t *first, const chunk_boundary_t *second)
+{
+	return lexer_checkpoints_equal(&first->lexer_state, &second->lexer_state) && first->line_start == second->line_start &&
+		   first->open_style_bit == second->open_style_bit;
+}
+
+/* Sets up a lexer and an emitter that continue from boundary, writing to output */
+static void resume_at_boundary(s2html_lexer_t *lexer, s2html_emitter_t *emitter, source_buffer_t *view, const source_buffer_t *source,
+							   const chunk_boundary_t *boundary, output_buffer_t *output, int options, int line_number)
+{
+	open_source_memory(view, source->data, source->length);
+	init_lexer(lexer, view);
+	restore_lexer_checkpoint(lexer, &boundary->lexer_state);
+	init_emitter(emitter, output, options);
+	emitter->current_line_number = line_number;
+	emitter->line_start = boundary->line_start;
+	emitter->open_style_bit = boundary->open_style_bit;
+}
+
+/* Files boundary under the entry and/or exit candidates of worker; returns 0 when out of memory */
+static int record_boundary(chunk_worker_t *worker, const chunk_boundary_t *boundary)
+{
+	size_t position = boundary->lexer_state.position;
+
+	if (position < worker->entry_limit && !push_boundary(&worker->entries, boundary))
+		return 0;
+	if (position >= worker->exit_from && !push_boundary(&worker->exits, boundary))
+		return 0;
+	return 1;
+}
+
+/* Lexes one chunk from worker->entry until the first boundary at or past exit_limit, or the end of the source */
+static void *lex_chunk(void *argument)
+{
+	chunk_worker_t *worker = argument;
+	source_buffer_t view;
+	s2html_lexer_t lexer;
+	s2html_emitter_t emitter;
+	chunk_boundary_t boundary = worker->entry;
+	parser_token_t *token;
+
+	resume_at_boundary(&lexer, &emitter, &view, worker->source, &worker->entry, &worker->output, worker->options, 1);
+	emitter.deferred_gutters = &worker->gutters;
+	boundary.output_offset = 0;
+	if (!record_boundary(worker, &boundary))
+	{
+		worker->failed = 1;
+		return NULL;
+	}
+
+	for (;;)
+	{
+		token = extract_next_token(&lexer);
+		convert_token_to_html(&emitter, token);
+		if (token->type == TOKEN_END_OF_FILE)
+		{
+			worker->reached_end = 1;
+			break;
+		}
+
+		save_lexer_checkpoint(&lexer, &boundary.lexer_state);
+		boundary.line_start = emitter.line_start;
+		boundary.open_style_bit = emitter.open_style_bit;
+		boundary.output_offset = worker->output.length;
+		if (!record_boundary(worker, &boundary))
+		{
+			worker->failed = 1;
+			break;
+		}
+		if (boundary.lexer_state.position >= worker->exit_limit)
+			break;
+	}
+	if (worker->output.error || worker->gutters.failed)
+		worker->failed = 1;
+	return NULL;
+}
+
+/* Lexes worker's chunk again on the calling thread, this time from a boundary known to be right */
+static void relex_chunk(chunk_worker_t *worker, const chunk_boundary_t *entry)
+{
+	worker->entry = *entry;
+	worker->output.length = 0;
+	worker->gutters.count = 0;
+	worker->entries.count = 0;
+	worker->exits.count = 0;
+	worker->reached_end = 0;
+	if (!worker->failed)
+		lex_chunk(worker);
+}
+
+/* Finds the first exit of current not behind from_position that next reached in the same state; returns 1 and both indices when there is one */
+static int find_join(const chunk_worker_t *current, const chunk_worker_t *next, size_t from_position, int *exit_index, int *entry_index)
+{
+	const chunk_boundary_t *exit, *entry;
+	int i, j = 0, k;
+
+	for (i = 0; i < current->exits.count; i++)
+	{
+		exit = &current->exits.items[i];
+		if (exit->lexer_state.position < from_position) /* current itself was joined past its chunk end */
+			continue;
+		while (j < next->entries.count && next->entries.items[j].lexer_state.position < exit->lexer_state.position)
+			j++;
+		for (k = j; k < next->entries.count; k++)
+		{
+			entry = &next->entries.items[k];
+			if (entry->lexer_state.position != exit->lexer_state.position)
+				break;
+			if (boundaries_equal(exit, entry))
+			{
+				*exit_index = i;
+				*entry_index = k;
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+/* Copies the chunk HTML in [from, to) to output, writing the gutters it passes; next_line numbers the next gutter */
+static void append_chunk_html(output_buffer_t *output, const chunk_worker_t *worker, size_t from, size_t to, int *next_line)
+{
+	const gutter_marks_t *marks = &worker->gutters;
+	size_t low = 0, high = marks->count, middle;
+
+	while (low < high) /* first gutter at or after from */
+	{
+		middle = low + (high - low) / 2;
+		if (marks->offsets[middle] < from)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	for (; low < marks->count && marks->offsets[low] < to; low++)
+	{
+		output_append(output, worker->output.data + from, marks->offsets[low] - from);
+		append_line_number(output, (*next_line)++, worker->options);
+		from = marks->offsets[low];
+	}
+	output_append(output, worker->output.data + from, to - from);
+}
+
+/* Converts the rest of source from boundary straight into output, used when a chunk ran out of memory */
+static void finish_serially(const source_buffer_t *source, const chunk_boundary_t *boundary, output_buffer_t *output, int options, int next_line)
+{
+	source_buffer_t view;
+	s2html_lexer_t lexer;
+	s2html_emitter_t emitter;
+	parser_token_t *token;
+
+	/* Without a pending gutter the current line already got next_line - 1 */
+	resume_at_boundary(&lexer, &emitter, &view, source, boundary, output, options, boundary->line_start ? next_line : next_line - 1);
+	do
+	{
+		token = extract_next_token(&lexer);
+		convert_token_to_html(&emitter, token);
+	} while (token->type != TOKEN_END_OF_FILE);
+}
+
+/* Picks chunk starts just after newlines and sets up one worker per chunk; returns the number of chunks, 0 when out of memory */
+static int plan_chunks(chunk_worker_t *workers, int chunk_count, const source_buffer_t *source, int options)
+{
+	source_buffer_t view;
+	s2html_lexer_t fresh;
+	const char *newline;
+	size_t starts[PARALLEL_MAX_CHUNKS], target;
+	int i, count = 1;
+
+	starts[0] = 0;
+	for (i = 1; i < chunk_count; i++)
+	{
+		target = source->length / chunk_count * i;
+		if (target < starts[count - 1])
+			continue;
+		if (NULL == (newline = memchr(source->data + target, '\n', source->length - target)))
+			break;
+		if ((size_t)(newline + 1 - source->data) < source->length)
+			starts[count++] = newline + 1 - source->data;
+	}
+
+	/* Every chunk is first lexed in the state a fresh lexer has */
+	open_source_memory(&view, source->data, source->length);
+	init_lexer(&fresh, &view);
+	for (i = 0; i < count; i++)
+	{
+		view.position = starts[i];
+		save_lexer_checkpoint(&fresh, &workers[i].entry.lexer_state);
+		workers[i].entry.line_start = 1;
+		workers[i].entry.open_style_bit = 0;
+		workers[i].entry.output_offset = 0;
+		workers[i].source = source;
+		workers[i].options = options;
+		workers[i].entry_limit = starts[i] + PARALLEL_RESYNC_WINDOW;
+		workers[i].exit_from = i + 1 < count ? starts[i + 1] : (size_t)-1;
+		workers[i].exit_limit = i + 1 < count ? starts[i + 1] + PARALLEL_RESYNC_WINDOW : (size_t)-1;
+		if (!open_memory_output_buffer(&workers[i].output))
+			return 0;
+	}
+	return count;
+}
+
+/* ********************************************************************************************************************** */
+/* ********************************************************************************************************************** */
+
+/* Converts source like convert_source_to_html, lexing newline aligned chunks on up to thread_count threads; the HTML is byte identical */
+void convert_source_parallel(source_buffer_t *source, output_buffer_t *output, int options, int thread_count, parallel_result_t *result)
+{
+	chunk_worker_t *workers = NULL;
+	chunk_worker_t *current, *next;
+	chunk_boundary_t joined;
+	s2html_emitter_t emitter;
+	output_buffer_t body, *document = output;	/* where the stitched HTML goes */
+	size_t from = 0;
+	int chunk_count = thread_count, planned_count = 0, next_line = 1, exit_index, entry_index, i;
+
+	result->chunk_count = 1;
+	result->relexed_count = 0;
+
+	/* A stream window cannot be shared between threads, and small inputs are not worth splitting */
+	if (chunk_count > PARALLEL_MAX_CHUNKS)
+		chunk_count = PARALLEL_MAX_CHUNKS;
+	if ((size_t)chunk_count > source->length / PARALLEL_MIN_CHUNK_SIZE)
+		chunk_count = source->length / PARALLEL_MIN_CHUNK_SIZE;
+	if (source->origin != SOURCE_ORIGIN_STREAM && chunk_count >= 2 && NULL != (workers = calloc(chunk_count, sizeof(*workers))))
+		planned_count = plan_chunks(workers, chunk_count, source, options);
+	if (planned_count < 2)
+	{
+		for (i = 0; workers && i < chunk_count; i++)
+			close_output_buffer(&workers[i].output);
+		free(workers);
+		convert_source_to_html(source, output, options);
+		return;
+	}
+	result->chunk_count = chunk_count = planned_count;
+
+	/* Chunk 0 runs on the calling thread; a chunk whose thread cannot start is lexed during the join below */
+	for (i = 1; i < chunk_count; i++)
+		workers[i].started = pthread_create(&workers[i].thread, NULL, lex_chunk, &workers[i]) == 0;
+	lex_chunk(&workers[0]);
+	for (i = 1; i < chunk_count; i++)
+	{
+		if (workers[i].started)
+			pthread_join(workers[i].thread, NULL);
+		else
+			lex_chunk(&workers[i]);
+	}
+
+	/* An embedded theme depends on the classes of the stitched HTML, so that is assembled in memory first */
+	init_emitter(&emitter, output, options);
+	if (emitter.embed_css && open_memory_output_buffer(&body))
+		document = &body;
+	else if (emitter.embed_css)
+		output->error = 1;
+	else
+		generate_html_header(&emitter, HTML_DOCUMENT_START);
+
+	/* Stitch: output of current is right from the joined boundary on */
+	joined = workers[0].entry;
+	for (i = 0; i < chunk_count; i++)
+	{
+		current = &workers[i];
+		next = i + 1 < chunk_count ? &workers[i + 1] : NULL;
+		if (current->failed)
+		{
+			finish_serially(source, &joined, document, options, next_line);
+			break;
+		}
+		if (next && !next->failed && find_join(current, next, joined.lexer_state.position, &exit_index, &entry_index))
+		{
+			append_chunk_html(document, current, from, current->exits.items[exit_index].output_offset, &next_line);
+			joined = next->entries.items[entry_index];
+			from = joined.output_offset;
+			continue;
+		}
+		if (next == NULL || current->reached_end)
+		{
+			append_chunk_html(document, current, from, current->output.length, &next_line);
+			break;
+		}
+
+		/* next started in the wrong state: lex it again from the last boundary current got right */
+		joined = current->exits.items[current->exits.count - 1];
+		append_chunk_html(document, current, from, joined.output_offset, &next_line);
+		relex_chunk(next, &joined);
+		from = 0;
+		result->relexed_count++;
+	}
+
+	if (document == &body)
+	{
+		emitter.used_classes = collect_style_classes(body.data, body.length, emitter.compact);
+		generate_html_header(&emitter, HTML_DOCUMENT_START);
+		output_append(output, body.data, body.length);
+		if (body.error)
+			output->error = 1;
+		close_output_buffer(&body);
+	}
+	generate_html_footer(&emitter, HTML_DOCUMENT_END);
+
+	for (i = 0; i < chunk_count; i++)
+	{
+		close_output_buffer(&workers[i].output);
+		free(workers[i].gutters.offsets);
+		free(workers[i].entries.items);
+		free(workers[i].exits.items);
+	}
+	free(workers);
+}
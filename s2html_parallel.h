@@ -0,0 +1,24 @@
+#ifndef S2HTML_PARALLEL_H
+#define S2HTML_PARALLEL_H
+
+#define PARALLEL_MAX_CHUNKS		256
+/* Both can be overridden at build time, so tests can exercise the chunk joins on small inputs */
+#ifndef PARALLEL_MIN_CHUNK_SIZE
+#define PARALLEL_MIN_CHUNK_SIZE	(256 * 1024)	/* smaller chunks cost more in thread start up than they save */
+#endif
+#ifndef PARALLEL_RESYNC_WINDOW
+#define PARALLEL_RESYNC_WINDOW	(64 * 1024)		/* how far past a chunk start the neighbours try to agree on a state */
+#endif
+
+typedef struct
+{
+	int chunk_count;			// chunks lexed in parallel
+	int relexed_count;			// chunks whose speculative entry state was wrong and were lexed again
+}parallel_result_t;
+
+/********** function prototypes **********/
+
+void convert_source_parallel(source_buffer_t *source, output_buffer_t *output, int options, int thread_count, parallel_result_t *result);
+
+#endif
+/**** End of file ****/
@@ -0,0 +1,505 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "s2html_event.h"
+#include "s2html_conv.h"
+#include "s2html_server.h"
+
+#define SERVER_OPTION_MASK		(CONVERT_LINE_NUMBERS | CONVERT_EMBED_CSS | CONVERT_COMPACT | CONVERT_LINE_ANCHORS)
+
+/*
+ * Highlighting daemon: a process that stays up and converts sources sent over a Unix domain socket, so a caller pays
+ * neither exec nor file costs per conversion. A connection carries any number of requests, one after the other:
+ *
+ *   request   u32 options (CONVERT_* flags), u32 source length, source bytes
+ *   response  u32 status (SERVER_STATUS_*), u32 length, HTML (or an error message)
+ *
+ * Every worker thread accepts connections itself and takes the source and the HTML of a request from its own arena,
+ * emptied after each request, so a conversion allocates nothing once the arena has grown to the usual size. The service time of each
+ * request (source received to HTML sent) goes into a log-linear histogram the report reads percentiles from.
+ */
+
+struct server;
+
+typedef struct
+{
+	struct server *server;
+	pthread_t thread;
+	int started;				// thread was created and must be joined
+	arena_t arena;				// scratch memory of the request being served, reset once it is answered
+	output_buffer_t html;		// response being built, a memory buffer cut from arena
+	pthread_mutex_t lock;		// guards client and stats against the report and the shutdown
+	int client;					// connection being served, -1 => none
+	server_stats_t stats;
+}server_worker_t;
+
+typedef struct server
+{
+	int listener;				// listening socket, shut down to stop the workers
+	volatile int stopping;		// set once a stop signal arrived
+	server_worker_t *workers;
+	int worker_count;
+}server_t;
+
+/********** Helper function implementations **********/
+
+static unsigned long long now_nanoseconds(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void put_u32(unsigned char *bytes, unsigned int value)
+{
+	bytes[0] = (unsigned char)value;
+	bytes[1] = (unsigned char)(value >> 8);
+	bytes[2] = (unsigned char)(value >> 16);
+	bytes[3] = (unsigned char)(value >> 24);
+}
+
+static unsigned int get_u32(const unsigned char *bytes)
+{
+	return bytes[0] | (unsigned int)bytes[1] << 8 | (unsigned int)bytes[2] << 16 | (unsigned int)bytes[3] << 24;
+}
+
+/* Reads exactly length bytes; returns 0 if the peer closed the connection or it failed first */
+static int read_exact(int socket_fd, void *data, size_t length)
+{
+	ssize_t count;
+
+	while (length > 0)
+	{
+		count = read(socket_fd, data, length);
+		if (count < 0 && errno == EINTR)
+			continue;
+		if (count <= 0)
+			return 0;
+		data = (char *)data + count;
+		length -= count;
+	}
+	return 1;
+}
+
+/* Writes exactly length bytes, without SIGPIPE when the peer went away; returns 0 on failure */
+static int write_exact(int socket_fd, const void *data, size_t length)
+{
+	ssize_t count;
+
+	while (length > 0)
+	{
+		count = send(socket_fd, data, length, MSG_NOSIGNAL);
+		if (count < 0 && errno == EINTR)
+			continue;
+		if (count <= 0)
+			return 0;
+		data = (const char *)data + count;
+		length -= count;
+	}
+	return 1;
+}
+
+/* Sends one frame: header with status or options and the payload length, then the payload; returns 0 without sending
+   anything when the length does not fit the header */
+static int write_frame(int socket_fd, unsigned int code, const char *payload, size_t length)
+{
+	unsigned char header[SERVER_FRAME_HEADER_SIZE];
+
+	if (length > SERVER_MAX_FRAME_SIZE)
+		return 0;
+	put_u32(header, code);
+	put_u32(header + 4, (unsigned int)length);
+	return write_exact(socket_fd, header, sizeof(header)) && write_exact(socket_fd, payload, length);
+}
+
+/* Fills address with path; returns 0 if the path does not fit */
+static int make_socket_address(struct sockaddr_un *address, const char *path)
+{
+	memset(address, 0, sizeof(*address));
+	address->sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(address->sun_path))
+		return 0;
+	strcpy(address->sun_path, path);
+	return 1;
+}
+
+/* Histogram bucket of a service time: exact below 8 ns, then 8 buckets per power of two */
+static int latency_bucket(unsigned long long nanoseconds)
+{
+	int top_bit;
+
+	if (nanoseconds < (1u << SERVER_LATENCY_SUB_BITS))
+		return (int)nanoseconds;
+	top_bit = 63 - __builtin_clzll(nanoseconds);
+	return ((top_bit - SERVER_LATENCY_SUB_BITS + 1) << SERVER_LATENCY_SUB_BITS)
+		| (int)((nanoseconds >> (top_bit - SERVER_LATENCY_SUB_BITS)) & ((1u << SERVER_LATENCY_SUB_BITS) - 1));
+}
+
+/* Largest service time that falls into bucket */
+static unsigned long long latency_bucket_limit(int bucket)
+{
+	int shift = (bucket >> SERVER_LATENCY_SUB_BITS) - 1;
+
+	if (bucket < (1 << SERVER_LATENCY_SUB_BITS))
+		return bucket;
+	return ((((unsigned long long)(bucket & ((1 << SERVER_LATENCY_SUB_BITS) - 1)) | (1u << SERVER_LATENCY_SUB_BITS)) + 1) << shift) - 1;
+}
+
+/* Service time at or below which fraction of the requests were answered, bounded by the slowest one */
+static unsigned long long latency_percentile(const server_stats_t *stats, double fraction)
+{
+	unsigned long long wanted = (unsigned long long)(fraction * stats->requests + 0.999999), seen = 0, limit;
+	int bucket;
+
+	if (stats->requests == 0)
+		return 0;
+	for (bucket = 0; bucket < SERVER_LATENCY_BUCKETS; bucket++)
+	{
+		seen += stats->latency[bucket];
+		if (seen >= wanted && seen > 0)
+			break;
+	}
+	limit = latency_bucket_limit(bucket < SERVER_LATENCY_BUCKETS ? bucket : SERVER_LATENCY_BUCKETS - 1);
+	return limit < stats->max_nanoseconds ? limit : stats->max_nanoseconds;
+}
+
+/* Sums the counters of every worker */
+static void collect_server_stats(server_t *server, server_stats_t *total)
+{
+	int i, bucket;
+
+	memset(total, 0, sizeof(*total));
+	for (i = 0; i < server->worker_count; i++)
+	{
+		pthread_mutex_lock(&server->workers[i].lock);
+		total->requests += server->workers[i].stats.requests;
+		total->failed += server->workers[i].stats.failed;
+		total->source_bytes += server->workers[i].stats.source_bytes;
+		total->html_bytes += server->workers[i].stats.html_bytes;
+		if (server->workers[i].stats.max_nanoseconds > total->max_nanoseconds)
+			total->max_nanoseconds = server->workers[i].stats.max_nanoseconds;
+		if (server->workers[i].stats.arena_high_water > total->arena_high_water)
+			total->arena_high_water = server->workers[i].stats.arena_high_water;
+		for (bucket = 0; bucket < SERVER_LATENCY_BUCKETS; bucket++)
+			total->latency[bucket] += server->workers[i].stats.latency[bucket];
+		pthread_mutex_unlock(&server->workers[i].lock);
+	}
+}
+
+/* Reads the source of a request into the worker's arena; returns NULL or why the request cannot be served */
+static const char *receive_source(server_worker_t *worker, int client, size_t length, char **data)
+{
+	if (NULL == (*data = arena_alloc(&worker->arena, length)))
+		return "out of memory";
+	return read_exact(client, *data, length) ? NULL : "connection closed";
+}
+
+/* Converts the received source into worker->html with the same pipeline as a file conversion */
+static void convert_request(server_worker_t *worker, unsigned int options, const char *data, size_t length)
+{
+	source_buffer_t source;
+
+	if (!open_arena_output_buffer(&worker->html, NULL, &worker->arena))
+	{
+		worker->html.error = 1;
+		return;
+	}
+	open_source_memory(&source, data, length);
+	convert_source_to_html(&source, &worker->html, (int)options);
+}
+
+/* Empties the arena once a request is answered, giving back what one large request grew it by */
+static void release_request_memory(server_worker_t *worker)
+{
+	memset(&worker->html, 0, sizeof(worker->html));
+	arena_reset(&worker->arena);
+	trim_arena(&worker->arena, SERVER_KEEP_BUFFER_SIZE);
+}
+
+/* Answers the requests of one connection until the client closes it or breaks the protocol */
+static void serve_connection(server_worker_t *worker, int client)
+{
+	unsigned char header[SERVER_FRAME_HEADER_SIZE];
+	unsigned int options, length;
+	unsigned long long started, elapsed;
+	server_stats_t report;
+	const char *error;
+	char *data;
+	int sent;
+
+	while (read_exact(client, header, sizeof(header)))
+	{
+		options = get_u32(header);
+		length = get_u32(header + 4);
+		started = now_nanoseconds();
+
+		if (options == SERVER_REQUEST_REPORT && length == 0)
+		{
+			collect_server_stats(worker->server, &report);
+			if (!open_arena_output_buffer(&worker->html, NULL, &worker->arena))
+				return;
+			append_server_report(&worker->html, &report);
+			sent = !worker->html.error && write_frame(client, SERVER_STATUS_OK, worker->html.data, worker->html.length);
+			release_request_memory(worker);
+			if (!sent)
+				return;
+			continue;
+		}
+
+		/* The source of a refused request is not read, so the connection cannot continue after it */
+		error = NULL;
+		if (options & ~SERVER_OPTION_MASK)
+			error = "unknown options";
+		else if (length > SERVER_MAX_SOURCE_SIZE)
+			error = "source too large";
+		else if (NULL == (error = receive_source(worker, client, length, &data)))
+		{
+			convert_request(worker, options, data, length);
+			if (worker->html.error)
+				error = "out of memory";
+			else if (worker->html.length > SERVER_MAX_FRAME_SIZE) /* escaping and gutters can grow a source 75 times */
+				error = "HTML too large for one frame";
+		}
+		if (error)
+			sent = write_frame(client, SERVER_STATUS_ERROR, error, strlen(error));
+		else
+			sent = write_frame(client, SERVER_STATUS_OK, worker->html.data, worker->html.length);
+		elapsed = now_nanoseconds() - started;
+
+		pthread_mutex_lock(&worker->lock);
+		worker->stats.requests++;
+		worker->stats.failed += error != NULL;
+		worker->stats.source_bytes += error ? 0 : length;
+		worker->stats.html_bytes += error ? 0 : worker->html.length;
+		worker->stats.latency[latency_bucket(elapsed)]++;
+		if (elapsed > worker->stats.max_nanoseconds)
+			worker->stats.max_nanoseconds = elapsed;
+		worker->stats.arena_high_water = worker->arena.high_water;
+		pthread_mutex_unlock(&worker->lock);
+
+		release_request_memory(worker);
+		if (error || !sent)
+			return;
+	}
+}
+
+/* Worker thread: accepts and serves connections until the listener is shut down */
+static void *server_worker_main(void *argument)
+{
+	server_worker_t *worker = argument;
+	server_t *server = worker->server;
+	int client, stopping;
+
+	for (;;)
+	{
+		if ((client = accept(server->listener, NULL, NULL)) < 0)
+		{
+			if (server->stopping)
+				break;
+			continue; /* EINTR, a connection reset before it was accepted, out of descriptors: try again */
+		}
+
+		/* Published before the stop flag is read, so a stop either sees the connection or is seen here */
+		pthread_mutex_lock(&worker->lock);
+		worker->client = client;
+		stopping = server->stopping;
+		pthread_mutex_unlock(&worker->lock);
+		if (!stopping)
+			serve_connection(worker, client);
+
+		pthread_mutex_lock(&worker->lock);
+		worker->client = -1;
+		pthread_mutex_unlock(&worker->lock);
+		close(client);
+	}
+	return NULL;
+}
+
+/* Creates the listening socket at path; returns NULL or a description of the failure */
+static const char *open_listener(server_t *server, const char *path)
+{
+	struct sockaddr_un address;
+	struct stat path_info;
+	int probe;
+
+	if (!make_socket_address(&address, path))
+		return "socket path too long";
+
+	/* A socket file nobody accepts on is left over from a server that died, and is replaced; connect() refuses
+	   a regular file the same way, so anything else at path is left alone */
+	if (lstat(path, &path_info) == 0)
+	{
+		if (!S_ISSOCK(path_info.st_mode))
+			return "path exists and is not a socket";
+		if ((probe = socket(AF_UNIX, SOCK_STREAM, 0)) >= 0)
+		{
+			if (connect(probe, (struct sockaddr *)&address, sizeof(address)) == 0)
+			{
+				close(probe);
+				return "another server is listening on this socket";
+			}
+			close(probe);
+			if (errno == ECONNREFUSED)
+				unlink(path);
+		}
+	}
+
+	if ((server->listener = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+		return "could not create socket";
+	if (bind(server->listener, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(server->listener, SOMAXCONN) != 0)
+	{
+		close(server->listener);
+		return "could not listen on socket";
+	}
+	return NULL;
+}
+
+/* ********************************************************************************************************************** */
+/* ********************************************************************************************************************** */
+
+/* Serves conversions on socket_path with worker_count threads, each with an arena of arena_size byte blocks (0 =>
+   default), until SIGINT or SIGTERM; total receives the counters of the whole run. Returns NULL after a clean stop or a description of the failure to start */
+const char *run_server(const char *socket_path, int worker_count, size_t arena_size, server_stats_t *total)
+{
+	server_t server;
+	sigset_t stop_signals, previous_mask;
+	const char *error;
+	int i, signal_number, started;
+
+	memset(total, 0, sizeof(*total));
+	if (worker_count < 1)
+		worker_count = SERVER_DEFAULT_WORKERS;
+	if (worker_count > SERVER_MAX_WORKERS)
+		worker_count = SERVER_MAX_WORKERS;
+	memset(&server, 0, sizeof(server));
+	if ((error = open_listener(&server, socket_path)) != NULL)
+		return error;
+	if (NULL == (server.workers = calloc(worker_count, sizeof(*server.workers))))
+	{
+		close(server.listener);
+		unlink(socket_path);
+		return "out of memory";
+	}
+	server.worker_count = worker_count;
+
+	/* The stop signals are taken by sigwait below; workers inherit the blocked mask */
+	sigemptyset(&stop_signals);
+	sigaddset(&stop_signals, SIGINT);
+	sigaddset(&stop_signals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &stop_signals, &previous_mask);
+
+	for (i = 0, started = 0; i < worker_count; i++)
+	{
+		server.workers[i].server = &server;
+		server.workers[i].client = -1;
+		pthread_mutex_init(&server.workers[i].lock, NULL);
+		init_arena(&server.workers[i].arena, arena_size);
+		server.workers[i].started = pthread_create(&server.workers[i].thread, NULL, server_worker_main, &server.workers[i]) == 0;
+		started += server.workers[i].started;
+	}
+
+	if (started == 0)
+	{
+		error = "could not start any worker";
+	}
+	else
+	{
+		printf("Serving on %s with %d workers, stop with Ctrl-C\n", socket_path, started);
+		fflush(stdout);
+		sigwait(&stop_signals, &signal_number);
+	}
+
+	/* Wake the workers: accept fails on the shut down listener and open connections see end of input */
+	server.stopping = 1;
+	shutdown(server.listener, SHUT_RDWR);
+	for (i = 0; i < worker_count; i++)
+	{
+		pthread_mutex_lock(&server.workers[i].lock);
+		if (server.workers[i].client >= 0)
+			shutdown(server.workers[i].client, SHUT_RD);
+		pthread_mutex_unlock(&server.workers[i].lock);
+	}
+	for (i = 0; i < worker_count; i++)
+	{
+		if (server.workers[i].started)
+			pthread_join(server.workers[i].thread, NULL);
+	}
+
+	collect_server_stats(&server, total);
+	for (i = 0; i < worker_count; i++)
+	{
+		pthread_mutex_destroy(&server.workers[i].lock);
+		free_arena(&server.workers[i].arena);
+	}
+	free(server.workers);
+	close(server.listener);
+	unlink(socket_path);
+	pthread_sigmask(SIG_SETMASK, &previous_mask, NULL);
+	return error;
+}
+
+/* Client side: sends one request to the server at socket_path and stores the payload of the answer in response, a
+   memory buffer. SERVER_REQUEST_REPORT as options asks for the report. Returns NULL on success, or a description of
+   the failure; when the server refused the request its message is in response */
+const char *request_conversion(const char *socket_path, unsigned int options, const char *data, size_t length, output_buffer_t *response)
+{
+	struct sockaddr_un address;
+	unsigned char header[SERVER_FRAME_HEADER_SIZE];
+	char chunk[OUTPUT_BUFFER_SIZE];
+	size_t remaining, count;
+	const char *error = NULL;
+	int server_fd;
+
+	if (length > SERVER_MAX_SOURCE_SIZE || length > SERVER_MAX_FRAME_SIZE)
+		return "source too large";
+	if (!make_socket_address(&address, socket_path))
+		return "socket path too long";
+	if ((server_fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+		return "could not create socket";
+	if (connect(server_fd, (struct sockaddr *)&address, sizeof(address)) != 0)
+	{
+		close(server_fd);
+		return "could not connect to the server";
+	}
+
+	if (!write_frame(server_fd, options, data, length) || !read_exact(server_fd, header, sizeof(header)))
+		error = "connection to the server failed";
+	for (remaining = error ? 0 : get_u32(header + 4); remaining > 0 && error == NULL; remaining -= count)
+	{
+		count = remaining < sizeof(chunk) ? remaining : sizeof(chunk);
+		if (!read_exact(server_fd, chunk, count))
+			error = "connection to the server failed";
+		else
+			output_append(response, chunk, count);
+	}
+	if (error == NULL && get_u32(header) != SERVER_STATUS_OK)
+		error = "the server refused the request";
+	close(server_fd);
+	return error;
+}
+
+/* Appends the counters and service time percentiles as one JSON object */
+void append_server_report(output_buffer_t *output, const server_stats_t *stats)
+{
+	static const struct { const char *name; double fraction; } percentiles[] = {
+		{"p50", 0.50}, {"p90", 0.90}, {"p99", 0.99}, {"p999", 0.999},
+	};
+	char text[256];
+	int i;
+
+	output_append(output, text, snprintf(text, sizeof(text), "{\"requests\":%llu,\"failed\":%llu,\"source_bytes\":%llu,\"html_bytes\":%llu,"
+										 "\"latency_us\":{", stats->requests, stats->failed, stats->source_bytes, stats->html_bytes));
+	for (i = 0; i < (int)(sizeof(percentiles) / sizeof(percentiles[0])); i++)
+		output_append(output, text, snprintf(text, sizeof(text), "\"%s\":%.1f,", percentiles[i].name,
+											 latency_percentile(stats, percentiles[i].fraction) / 1000.0));
+	output_append(output, text, snprintf(text, sizeof(text), "\"max\":%.1f},\"arena_high_water_bytes\":%llu}\n",
+										 stats->max_nanoseconds / 1000.0, stats->arena_high_water));
+}
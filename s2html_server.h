@@ -0,0 +1,40 @@
+#ifndef S2HTML_SERVER_H
+#define S2HTML_SERVER_H
+
+#include "s2html_output.h"
+#include "s2html_arena.h"
+
+#define SERVER_DEFAULT_WORKERS		4
+#define SERVER_MAX_WORKERS			256
+#define SERVER_MAX_SOURCE_SIZE		(256u * 1024 * 1024)	/* larger requests are refused */
+#define SERVER_KEEP_BUFFER_SIZE		(16u * 1024 * 1024)		/* worker arena memory past this is released after the request */
+#define SERVER_FRAME_HEADER_SIZE	8						/* u32 options or status, u32 length, both little endian */
+#ifndef SERVER_MAX_FRAME_SIZE	/* can be lowered at build time, so tests can reach it without gigabytes of HTML */
+#define SERVER_MAX_FRAME_SIZE		0xffffffffu				/* the most a frame's length field holds */
+#endif
+#define SERVER_REQUEST_REPORT		0x80000000u				/* request options: no source, answer with the server report */
+#define SERVER_STATUS_OK			0
+#define SERVER_STATUS_ERROR			1						/* the payload is a message instead of HTML */
+#define SERVER_LATENCY_SUB_BITS		3						/* 8 histogram buckets per power of two, about 12% apart */
+#define SERVER_LATENCY_BUCKETS		((64 - SERVER_LATENCY_SUB_BITS + 1) << SERVER_LATENCY_SUB_BITS)
+
+/* Request counters and service time histogram, of one worker or summed over all of them */
+typedef struct
+{
+	unsigned long long requests;		// conversions answered, failed ones included
+	unsigned long long failed;			// requests answered with an error
+	unsigned long long source_bytes;	// source bytes received
+	unsigned long long html_bytes;		// HTML bytes sent
+	unsigned long long max_nanoseconds;	// slowest request
+	unsigned long long arena_high_water;	// most scratch memory one request took (the largest of the workers)
+	unsigned long long latency[SERVER_LATENCY_BUCKETS];	// requests per service time bucket
+}server_stats_t;
+
+/********** function prototypes **********/
+
+const char *run_server(const char *socket_path, int worker_count, size_t arena_size, server_stats_t *total);
+const char *request_conversion(const char *socket_path, unsigned int options, const char *data, size_t length, output_buffer_t *response);
+void append_server_report(output_buffer_t *output, const server_stats_t *stats);
+
+#endif
+/**** End of file ****/
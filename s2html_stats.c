@@ -0,0 +1,142 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "s2html_stats.h"
+
+static const char *const state_names[STATS_PARSER_STATE_COUNT] = {
+	"idle", "preprocessor_directive", "preprocessor_main", "preprocessor_keyword", "preprocessor_ascii_char",
+	"header_file", "reserve_keyword", "numeric_constant", "string", "single_line_comment", "multi_line_comment",
+	"format_specifier", "operators", "symbols", "ascii_char",
+};
+
+static const char *const token_names[STATS_TOKEN_TYPE_COUNT] = {
+	"unknown", "preprocessor_directive", "reserve_keyword", "numeric_constant", "string_literal", "header_file",
+	"regular_text", "single_line_comment", "multi_line_comment", "ascii_char", "format_specifier", "operators",
+	"symbol", "end_of_file",
+};
+
+/********** Helper function implementations **********/
+
+static double share_percent(unsigned long long part, unsigned long long whole)
+{
+	return whole ? 100.0 * part / whole : 0.0;
+}
+
+static void print_stats_table(FILE *stream, const s2html_stats_t *stats)
+{
+	unsigned long long lexer_nanoseconds = 0, lexer_bytes = 0, token_count = 0;
+	int i;
+
+	for (i = 0; i < STATS_PARSER_STATE_COUNT; i++)
+	{
+		lexer_nanoseconds += stats->state_nanoseconds[i];
+		lexer_bytes += stats->state_characters[i];
+	}
+	for (i = 0; i < STATS_TOKEN_TYPE_COUNT; i++)
+		token_count += stats->tokens[i];
+
+	fprintf(stream, "\n%-26s %12s %14s %12s %7s\n", "lexer state", "entered", "bytes", "time ms", "share");
+	for (i = 0; i < STATS_PARSER_STATE_COUNT; i++)
+	{
+		if (stats->state_transitions[i] == 0 && stats->state_characters[i] == 0)
+			continue;
+		fprintf(stream, "%-26s %12llu %14llu %12.3f %6.1f%%\n", state_names[i], stats->state_transitions[i], stats->state_characters[i],
+				stats->state_nanoseconds[i] / 1e6, share_percent(stats->state_nanoseconds[i], lexer_nanoseconds));
+	}
+
+	fprintf(stream, "\n%-26s %12s %7s\n", "token type", "emitted", "share");
+	for (i = 0; i < STATS_TOKEN_TYPE_COUNT; i++)
+	{
+		if (stats->tokens[i] == 0)
+			continue;
+		fprintf(stream, "%-26s %12llu %6.1f%%\n", token_names[i], stats->tokens[i], share_percent(stats->tokens[i], token_count));
+	}
+
+	fprintf(stream, "\n%-26s %12llu", "source bytes", stats->source_bytes);
+	if (lexer_bytes != stats->source_bytes)
+		fprintf(stream, " (states add up to %llu: the byte counts are off)", lexer_bytes);
+	fprintf(stream, "\n%-26s %12llu\n", "bytes escaped", stats->bytes_escaped);
+	fprintf(stream, "%-26s %12llu (%llu bytes)\n", "rewinds", stats->rewinds, stats->rewound_bytes);
+	fprintf(stream, "%-26s %12llu\n", "output bytes", stats->output_bytes);
+	fprintf(stream, "%-26s %12.3f (lexer %.3f, rest %.3f)\n", "conversion ms", stats->total_nanoseconds / 1e6, lexer_nanoseconds / 1e6,
+			stats->total_nanoseconds > lexer_nanoseconds ? (stats->total_nanoseconds - lexer_nanoseconds) / 1e6 : 0.0);
+}
+
+static void print_stats_json(FILE *stream, const s2html_stats_t *stats)
+{
+	int i;
+
+	fprintf(stream, "{\n  \"states\": {");
+	for (i = 0; i < STATS_PARSER_STATE_COUNT; i++)
+		fprintf(stream, "%s\n    \"%s\": {\"entered\": %llu, \"bytes\": %llu, \"nanoseconds\": %llu}", i ? "," : "", state_names[i],
+				stats->state_transitions[i], stats->state_characters[i], stats->state_nanoseconds[i]);
+	fprintf(stream, "\n  },\n  \"tokens\": {");
+	for (i = 0; i < STATS_TOKEN_TYPE_COUNT; i++)
+		fprintf(stream, "%s\n    \"%s\": %llu", i ? "," : "", token_names[i], stats->tokens[i]);
+	fprintf(stream, "\n  },\n  \"bytes_escaped\": %llu,\n  \"rewinds\": %llu,\n  \"rewound_bytes\": %llu,\n  \"output_bytes\": %llu,\n"
+			"  \"source_bytes\": %llu,\n  \"total_nanoseconds\": %llu\n}\n", stats->bytes_escaped, stats->rewinds, stats->rewound_bytes,
+			stats->output_bytes, stats->source_bytes, stats->total_nanoseconds);
+}
+
+/* ********************************************************************************************************************** */
+/* ********************************************************************************************************************** */
+
+unsigned long long stats_now_nanoseconds(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void init_stats(s2html_stats_t *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	stats->timed_state = -1;
+	stats->counted_state = -1;
+}
+
+/* Starts timing the lexer in state; entering a state other than the one timed last counts as a transition */
+void stats_start_timer(s2html_stats_t *stats, int state)
+{
+	if (state != stats->timed_state)
+		stats->state_transitions[state]++;
+	stats->timed_state = state;
+	stats->timed_since = stats_now_nanoseconds();
+}
+
+/* Charges the time since the last change to the previous state and starts timing state */
+void stats_enter_state(s2html_stats_t *stats, int state)
+{
+	unsigned long long now = stats_now_nanoseconds();
+
+	stats->state_nanoseconds[stats->timed_state] += now - stats->timed_since;
+	stats->state_transitions[state]++;
+	stats->timed_state = state;
+	stats->timed_since = now;
+}
+
+/* Charges the running time to the current state and stops the timer until the lexer runs again */
+void stats_stop_timer(s2html_stats_t *stats)
+{
+	stats->state_nanoseconds[stats->timed_state] += stats_now_nanoseconds() - stats->timed_since;
+}
+
+/* Charges the bytes from the last call up to offset to the state given then, and charges the bytes from offset on to
+   state (-1 => to none). Charging by cursor offset counts the runs the handlers consume and the bytes they step back over
+   exactly once */
+void stats_count_bytes(s2html_stats_t *stats, int state, unsigned long long offset)
+{
+	if (stats->counted_state >= 0)
+		stats->state_characters[stats->counted_state] += offset - stats->counted_from;
+	stats->counted_state = state;
+	stats->counted_from = offset;
+}
+
+/* Prints the counters as aligned tables, or as one JSON object */
+void print_stats(FILE *stream, const s2html_stats_t *stats, int json)
+{
+	if (json)
+		print_stats_json(stream, stats);
+	else
+		print_stats_table(stream, stats);
+}
@@ -0,0 +1,49 @@
+#ifndef S2HTML_STATS_H
+#define S2HTML_STATS_H
+
+#include <stdio.h>
+#include "s2html_event.h"
+
+#define STATS_PARSER_STATE_COUNT	(PARSE_STATE_ASCII_CHAR + 1)
+#define STATS_TOKEN_TYPE_COUNT		(TOKEN_END_OF_FILE + 1)
+
+/*
+ * Counters are only collected in builds with -DS2HTML_STATS. Without it every STATS_* macro expands to nothing, so
+ * the lexer and emitter hot loops are exactly what they are without instrumentation.
+ */
+typedef struct s2html_stats
+{
+	unsigned long long state_nanoseconds[STATS_PARSER_STATE_COUNT];	// lexer time spent in each state
+	unsigned long long state_transitions[STATS_PARSER_STATE_COUNT];	// times each state was entered
+	unsigned long long state_characters[STATS_PARSER_STATE_COUNT];	// source bytes consumed in each state, runs included
+	unsigned long long tokens[STATS_TOKEN_TYPE_COUNT];				// tokens emitted of each type
+	unsigned long long bytes_escaped;		// source bytes written as an HTML entity
+	unsigned long long rewinds;				// source_unget calls
+	unsigned long long rewound_bytes;		// bytes stepped back over by those calls
+	unsigned long long output_bytes;		// HTML bytes written
+	unsigned long long total_nanoseconds;	// whole conversion, header to footer
+	unsigned long long source_bytes;		// bytes in the converted sources, what state_characters adds up to
+	int timed_state;						// state the lexer timer charges, -1 before the first token
+	unsigned long long timed_since;			// when the timer last started or changed state
+	int counted_state;						// state the bytes since counted_from are charged to, -1 if none
+	unsigned long long counted_from;		// source offset where the bytes not yet charged start
+}s2html_stats_t;
+
+#ifdef S2HTML_STATS
+#define STATS_ADD(stats, field, amount)		do { if (stats) (stats)->field += (amount); } while (0)
+#else
+#define STATS_ADD(stats, field, amount)		((void)0)
+#endif
+
+/********** function prototypes **********/
+
+unsigned long long stats_now_nanoseconds(void);
+void init_stats(s2html_stats_t *stats);
+void stats_start_timer(s2html_stats_t *stats, int state);
+void stats_enter_state(s2html_stats_t *stats, int state);
+void stats_stop_timer(s2html_stats_t *stats);
+void stats_count_bytes(s2html_stats_t *stats, int state, unsigned long long offset);
+void print_stats(FILE *stream, const s2html_stats_t *stats, int json);
+
+#endif
+/**** End of file ****/
@@ -0,0 +1,35 @@
+/* Generated by s2html_themegen from styles.css - do not edit */
+
+#ifndef S2HTML_THEME_H
+#define S2HTML_THEME_H
+
+#define THEME_RULE_COUNT		15
+#define THEME_HASH				0x160c5cae1318db0aULL
+
+typedef struct
+{
+	const char *style_class;	// class the rule styles, NULL => always embedded
+	const char *css;			// minified rule
+	unsigned short length;		// strlen(css)
+}theme_rule_t;
+
+static const theme_rule_t theme_rules[THEME_RULE_COUNT] = {
+	{NULL, "body{background-color:#1e1e1e;color:#d4d4d4;font-family:Consolas,'Courier New',monospace;margin:0;padding:0}", 108},
+	{"code-container", ".code-container{display:block;width:100%}", 41},
+	{"line-number", ".line-number{color:#858585;user-select:none;display:inline-block;text-align:right;padding-right:12px;margin-right:8px;border-right:1px solid #3e3e3e;min-width:40px}", 164},
+	{"reserved_key1", ".reserved_key1{color:#569cd6}", 29},
+	{"reserved_key2", ".reserved_key2{color:#4ec9b0}", 29},
+	{"comment", ".comment{color:#6a9955;font-style:italic}", 41},
+	{"preprocess_dir", ".preprocess_dir{color:#c586c0}", 30},
+	{"header_file", ".header_file{color:#ce9178}", 27},
+	{"string", ".string{color:#ce9178}", 22},
+	{"numeric_constant", ".numeric_constant{color:#b5cea8}", 32},
+	{"ascii_char", ".ascii_char{color:#d7ba7d}", 26},
+	{"format_specifier", ".format_specifier{color:#dcdcaa}", 32},
+	{"operators", ".operators{color:#d4d4d4}", 25},
+	{"symbols", ".symbols{color:#d4d4d4}", 23},
+	{NULL, "pre{margin:0;padding:10px;overflow-x:auto;line-height:1.4}", 58},
+};
+
+#endif
+/**** End of file ****/
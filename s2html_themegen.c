@@ -0,0 +1,216 @@
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Theme generator: reads a stylesheet and prints s2html_theme.h, the minified rules of the stylesheet as constants
+ * so --embed-css needs no file at run time. A rule whose selector is a single class is tagged with that class and
+ * only embedded when the document uses it; every other rule is always embedded. With --compact it prints the stylesheet
+ * for --compact documents instead: the same rules with the class selectors renamed as s2html_styles.def lists them.
+ *
+ *   gcc s2html_themegen.c -o s2html_themegen && ./s2html_themegen styles.css > s2html_theme.h
+ *   ./s2html_themegen --compact styles.css > styles-compact.css
+ */
+
+#define MAX_STYLESHEET_SIZE		(64 * 1024)
+#define MAX_RULES				128
+
+typedef struct
+{
+	char css[1024];				// minified rule
+	char style_class[64];		// class of a ".name" selector, empty for any other selector
+}theme_rule_t;
+
+typedef struct
+{
+	const char *class_name;
+	const char *compact_name;
+}style_class_t;
+
+static const style_class_t style_classes[] = {
+#define STYLE_CLASS(style, class_name, compact_name) { class_name, compact_name },
+#include "s2html_styles.def"
+#undef STYLE_CLASS
+};
+
+#define STYLE_CLASS_COUNT ((int)(sizeof(style_classes) / sizeof(style_classes[0])))
+
+/********** Helper function implementations **********/
+
+static int is_space(int character)
+{
+	return character == ' ' || character == '\t' || character == '\n' || character == '\r' || character == '\f';
+}
+
+/* No space is needed on either side of these */
+static int is_separator(int character)
+{
+	return character == '{' || character == '}' || character == ':' || character == ';' || character == ',' || character == '>';
+}
+
+/* Drops comments and every space a browser does not need, leaving quoted text alone */
+static size_t minify(const char *text, size_t length, char *minified)
+{
+	size_t i = 0, count = 0;
+	char quote;
+	int pending_space = 0;
+
+	while (i < length)
+	{
+		if (text[i] == '/' && i + 1 < length && text[i + 1] == '*')
+		{
+			for (i += 2; i + 1 < length && !(text[i] == '*' && text[i + 1] == '/'); i++)
+				;
+			i += 2;
+			pending_space = 1;
+			continue;
+		}
+		if (is_space(text[i]))
+		{
+			pending_space = 1;
+			i++;
+			continue;
+		}
+		if (pending_space && count > 0 && !is_separator(minified[count - 1]) && !is_separator(text[i]))
+			minified[count++] = ' ';
+		pending_space = 0;
+		if (text[i] == '}' && count > 0 && minified[count - 1] == ';')
+			count--; /* the last declaration needs no terminator */
+		if (text[i] == '"' || text[i] == '\'')
+		{
+			quote = text[i];
+			do
+				minified[count++] = text[i++];
+			while (i < length && text[i] != quote);
+			if (i < length)
+				minified[count++] = text[i++];
+			continue;
+		}
+		minified[count++] = text[i++];
+	}
+	minified[count] = '\0';
+	return count;
+}
+
+/* Splits minified text into rules; returns the number of rules, -1 if one does not fit */
+static int split_rules(const char *minified, theme_rule_t *rules)
+{
+	const char *start = minified, *end, *selector_end;
+	size_t length, class_length;
+	int count = 0;
+
+	while (*start && NULL != (end = strchr(start, '}')))
+	{
+		length = end + 1 - start;
+		if (count == MAX_RULES || length >= sizeof(rules[count].css))
+			return -1;
+		memcpy(rules[count].css, start, length);
+		rules[count].css[length] = '\0';
+
+		/* ".name{" styles one class; anything else (elements, lists, descendants) is kept unconditionally */
+		rules[count].style_class[0] = '\0';
+		selector_end = strchr(rules[count].css, '{');
+		class_length = selector_end ? (size_t)(selector_end - rules[count].css) - 1 : 0;
+		if (rules[count].css[0] == '.' && class_length > 0 && class_length < sizeof(rules[count].style_class) &&
+			strspn(rules[count].css + 1, "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-") == class_length)
+		{
+			memcpy(rules[count].style_class, rules[count].css + 1, class_length);
+			rules[count].style_class[class_length] = '\0';
+		}
+		count++;
+		start = end + 1;
+	}
+	return count;
+}
+
+/* Prints text as a C string literal */
+static void print_literal(const char *text)
+{
+	putchar('"');
+	for (; *text; text++)
+	{
+		if (*text == '"' || *text == '\\')
+			putchar('\\');
+		putchar(*text);
+	}
+	putchar('"');
+}
+
+/* Prints the rules as a stylesheet for --compact documents, one rule per line */
+static void print_compact_stylesheet(const char *path, const theme_rule_t *rules, int count)
+{
+	int rule, style;
+
+	printf("/* Generated by s2html_themegen --compact from %s - do not edit */\n", path);
+	for (rule = 0; rule < count; rule++)
+	{
+		for (style = 0; style < STYLE_CLASS_COUNT && strcmp(style_classes[style].class_name, rules[rule].style_class) != 0; style++)
+			;
+		if (rules[rule].style_class[0] && style < STYLE_CLASS_COUNT)
+			printf(".%s%s\n", style_classes[style].compact_name, rules[rule].css + 1 + strlen(rules[rule].style_class));
+		else
+			printf("%s\n", rules[rule].css);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	static char stylesheet[MAX_STYLESHEET_SIZE], minified[MAX_STYLESHEET_SIZE];
+	static theme_rule_t rules[MAX_RULES];
+	int compact = argc > 1 && strcmp(argv[1], "--compact") == 0;
+	const char *path = argc > 1 + compact ? argv[1 + compact] : "styles.css";
+	unsigned long long hash = 0xcbf29ce484222325ULL;
+	size_t length, minified_length, i;
+	FILE *input;
+	int count, rule;
+
+	if (NULL == (input = fopen(path, "r")))
+	{
+		fprintf(stderr, "Error! could not open %s\n", path);
+		return 1;
+	}
+	length = fread(stylesheet, 1, sizeof(stylesheet), input);
+	fclose(input);
+	if (length == sizeof(stylesheet))
+	{
+		fprintf(stderr, "Error! %s is larger than %d bytes\n", path, MAX_STYLESHEET_SIZE);
+		return 1;
+	}
+
+	minified_length = minify(stylesheet, length, minified);
+	if ((count = split_rules(minified, rules)) < 0)
+	{
+		fprintf(stderr, "Error! %s has more than %d rules or a rule longer than %d bytes\n", path, MAX_RULES, (int)sizeof(rules[0].css) - 1);
+		return 1;
+	}
+
+	if (compact)
+	{
+		print_compact_stylesheet(path, rules, count);
+		return 0;
+	}
+
+	/* FNV-1a of the minified rules: cached HTML with an embedded theme must not outlive the theme */
+	for (i = 0; i < minified_length; i++)
+		hash = (hash ^ (unsigned char)minified[i]) * 0x100000001b3ULL;
+
+	printf("/* Generated by s2html_themegen from %s - do not edit */\n\n", path);
+	printf("#ifndef S2HTML_THEME_H\n#define S2HTML_THEME_H\n\n");
+	printf("#define THEME_RULE_COUNT\t\t%d\n", count);
+	printf("#define THEME_HASH\t\t\t\t0x%016llxULL\n\n", hash);
+	printf("typedef struct\n{\n\tconst char *style_class;\t// class the rule styles, NULL => always embedded\n");
+	printf("\tconst char *css;\t\t\t// minified rule\n\tunsigned short length;\t\t// strlen(css)\n}theme_rule_t;\n\n");
+	printf("static const theme_rule_t theme_rules[THEME_RULE_COUNT] = {\n");
+	for (rule = 0; rule < count; rule++)
+	{
+		printf("\t{");
+		if (rules[rule].style_class[0])
+			print_literal(rules[rule].style_class);
+		else
+			printf("NULL");
+		printf(", ");
+		print_literal(rules[rule].css);
+		printf(", %u},\n", (unsigned int)strlen(rules[rule].css));
+	}
+	printf("};\n\n#endif\n/**** End of file ****/\n");
+	return 0;
+}
@@ -0,0 +1,39 @@
+#!/bin/sh
+# --serve must never delete what is at its socket path unless it is a stale socket.
+#   tests/serve_socket_path.sh ./syntaxglow
+# Exits non-zero on the first failure.
+
+tool=${1:-./syntaxglow}
+directory=$(mktemp -d) || exit 1
+trap 'rm -rf "$directory"' EXIT
+
+# A regular file is refused and kept
+echo precious > "$directory/precious.txt"
+if "$tool" --serve "$directory/precious.txt" > "$directory/out" 2>&1; then
+	echo "FAIL: --serve started on a regular file"
+	exit 1
+fi
+if [ "$(cat "$directory/precious.txt" 2>/dev/null)" != "precious" ]; then
+	echo "FAIL: --serve removed or changed a regular file"
+	exit 1
+fi
+grep -q "not a socket" "$directory/out" || { echo "FAIL: no 'not a socket' error"; exit 1; }
+
+# A socket left by a killed server is replaced
+"$tool" --serve "$directory/s.sock" > /dev/null 2>&1 &
+server=$!
+sleep 1
+kill -9 $server
+wait $server 2> /dev/null
+[ -S "$directory/s.sock" ] || { echo "FAIL: no socket left to test with"; exit 1; }
+"$tool" --serve "$directory/s.sock" > /dev/null 2>&1 &
+server=$!
+sleep 1
+printf 'int x;\n' > "$directory/a.c"
+"$tool" --connect "$directory/s.sock" "$directory/a.c" -o "$directory/a.html" > /dev/null
+status=$?
+kill $server
+wait $server 2> /dev/null
+[ $status -eq 0 ] || { echo "FAIL: a stale socket was not replaced"; exit 1; }
+
+echo "serve socket path: ok"
@@ -0,0 +1,28 @@
+#!/bin/sh
+# The per-state byte counts of --stats must add up to the size of the source, read from a file or from stdin.
+#   tests/stats_bytes.sh ./syntaxglow_stats [source files...]
+# Needs a -DS2HTML_STATS build. Exits non-zero on the first failure.
+
+tool=${1:-./syntaxglow_stats}
+[ $# -gt 0 ] && shift
+[ $# -gt 0 ] || set -- test s2html_event.c s2html_conv.c
+directory=$(mktemp -d) || exit 1
+trap 'rm -rf "$directory"' EXIT
+
+for source in "$@"; do
+	size=$(wc -c < "$source")
+	for from in file stdin; do
+		if [ $from = file ]; then
+			"$tool" "$source" -o "$directory/out.html" --stats=json > /dev/null 2> "$directory/stats" || { echo "FAIL: $source did not convert"; exit 1; }
+		else
+			"$tool" - -o "$directory/out.html" --stats=json < "$source" > /dev/null 2> "$directory/stats" || { echo "FAIL: $source did not convert"; exit 1; }
+		fi
+		states=$(awk -F'"bytes": ' 'NF > 1 { split($2, value, ","); sum += value[1] } END { print sum + 0 }' "$directory/stats")
+		if [ "$states" -ne "$size" ]; then
+			echo "FAIL: $source from $from: lexer states add up to $states bytes, the source has $size"
+			exit 1
+		fi
+	done
+done
+
+echo "stats bytes: ok"